@@ -2,6 +2,11 @@
 
 #include "MFrameWork.h"
 #include "GameOfLifeOnCube/Type.h"
+#include "GameOfLifeOnCube/Blend.h"
+#include "GameOfLifeOnCube/Parallel.h"
+#include "GameOfLifeOnCube/Raster.h"
+#include "GameOfLifeOnCube/Scheduler.h"
+#include "GameOfLifeOnCube/StepKernel.h"
 
 namespace Gol3d {
 
@@ -25,12 +30,22 @@ namespace Gol3d {
     {
     public:
         virtual ~ISprite() noexcept {}
-        virtual void PushImageWithAlphaBlend(uint16_t *pImage, Rect rect, Position pos, uint8_t alpha, uint8_t bgAlpha) noexcept = 0;
-        virtual void PushImageAffineWithAlphaBlend(uint16_t* pImage, Rect rect, float affine[6], uint8_t alpha, uint8_t bgAlpha) noexcept = 0;
+        virtual void PushImageWithAlphaBlend(const uint16_t* pImage, Rect rect, Position pos, uint8_t alpha, uint8_t bgAlpha) noexcept = 0;
+        // Draws the cells of states on the parallelogram dst[0] (top left), dst[1] (top right), dst[2] (bottom left)
+        // (see RasterizeParallelogram()), the state s in pRamp[s], blended as PushImageWithAlphaBlend() does.
+        virtual void DrawCellsWithAlphaBlend(const StateBitmap& states, const uint16_t* pRamp, const FPosition dst[3], uint8_t alpha, uint8_t bgAlpha) noexcept = 0;
+        // The same parallelogram in a single color, for faces whose cells are all in one state.
+        virtual void FillWithAlphaBlend(const FPosition dst[3], uint16_t color, uint8_t alpha, uint8_t bgAlpha) noexcept = 0;
     };
 
     typedef ISprite* (*GetSprite)();
 
+    typedef void (*ReportStepKernel)(StepKernel kernel, unsigned long microseconds);
+
+    // Steps cubes like the one of Cube() with each step kernel of the device and reports the microseconds
+    // a generation took. Returns the fastest one, Auto for rules that have only one.
+    StepKernel BenchmarkStepKernels(GetMicros getMicros, IParallel* pParallel, ReportStepKernel report = nullptr) noexcept;
+
     class IInput
     {        
     public:
@@ -72,8 +87,6 @@ namespace detail {
         const Position m_Position;
         const int m_Kind;
         bool m_Selected = false;
-
-        alignas(32) uint16_t m_Buffer[IconWidth * IconHeight];
     };
 
     extern const IconContext StartIconContext;
@@ -92,7 +105,10 @@ namespace detail {
     class Cube : public MFW::IObject
     {
     public:
-        Cube(GetSprite pSprite, Position position, int length, long seed) noexcept;
+        // generationsPerSecond is Scheduler::Turbo to step as often as a frame allows
+        // stepKernel is ignored by rules that have only one (see BenchmarkStepKernels())
+        Cube(GetSprite pSprite, Position position, int length, long seed, Topology topology, GetMicros getMicros, int generationsPerSecond,
+             IParallel* pParallel = nullptr, StepKernel stepKernel = StepKernel::Auto) noexcept;
 
     public:
         virtual void Update() noexcept final;
@@ -104,12 +120,13 @@ namespace detail {
 
     private:
         Position NormalizePosition(float x, float) const noexcept;
-        void DrawSurface(int surfaceIndex, const Position vertexPosition[8], const bool* pGameOfLifeBitmap) noexcept;
+        void DrawSurface(int surfaceIndex, const Position vertexPosition[8], const StateBitmap& gameOfLifeStates) noexcept;
 
     private:
         GetSprite m_GetSprite;
         const Position m_Position;
         const int m_Length;
+        Scheduler m_Scheduler;
 
         Vector3d m_Vertex[8];
         Axes3d m_Attitude;
@@ -118,11 +135,22 @@ namespace detail {
         const Vector3d m_WorldPosition = { 0.0, 0.0, 0.0 };
         const float m_Acceleration = 0.99;
 
-        static const int BufferWidth = 64;
-        static const int BufferHeight = 64;
-        alignas(32) uint16_t m_Buffer[BufferWidth * BufferHeight];
+        // the state all cells of a face are in as of generation and revision, -1 when they differ
+        struct FaceCache
+        {
+            uint64_t generation;
+            uint64_t revision;
+            int uniformState;
+        };
+
+        static const int FaceCount = 6;
+        FaceCache m_FaceCaches[FaceCount];
     };
 
+    // generations the cube has stepped, not counting paused or replayed ones, for the rate next to the fps
+    // (read from any core)
+    uint32_t GetGenerationCount() noexcept;
+
     class InputEvent : public MFW::IObject
     {
     public:
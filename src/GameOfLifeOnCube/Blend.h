@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Gol3d {
+
+    // fg over bg (RGB565), each channel ((2 fg + 1) alpha + (2 bg + 1) (255 - alpha)) >> 9
+    constexpr uint16_t AlphaBlend(uint8_t alpha, uint16_t fg, uint16_t bg)
+    {
+        return static_cast<uint16_t>(
+            (((((fg >> 10) & 0x3E) + 1) * alpha + (((bg >> 10) & 0x3E) + 1) * (255 - alpha)) >> 9) << 11 |
+            (((((fg >>  4) & 0x7E) + 1) * alpha + (((bg >>  4) & 0x7E) + 1) * (255 - alpha)) >> 9) <<  5 |
+            (((((fg <<  1) & 0x3E) + 1) * alpha + (((bg <<  1) & 0x3E) + 1) * (255 - alpha)) >> 9) <<  0);
+    }
+
+namespace detail {
+
+    // A channel of the two swapped RGB565 pixels of a word (the low and the high half), a 16 bit lane each.
+    // Swapped, the bits of a pixel are GGGBBBBB RRRRRGGG from the top.
+    constexpr uint32_t GetRed2(uint32_t pixels)
+    {
+        return (pixels >> 3) & 0x001F001F;
+    }
+
+    constexpr uint32_t GetGreen2(uint32_t pixels)
+    {
+        return ((pixels & 0x00070007) << 3) | ((pixels >> 13) & 0x00070007);
+    }
+
+    constexpr uint32_t GetBlue2(uint32_t pixels)
+    {
+        return (pixels >> 8) & 0x001F001F;
+    }
+
+    constexpr uint32_t MakePixels2(uint32_t red, uint32_t green, uint32_t blue)
+    {
+        return (red << 3) | ((green >> 3) & 0x00070007) | (blue << 8) | ((green & 0x00070007) << 13);
+    }
+
+    // (fg alpha + 127) in both lanes
+    constexpr uint32_t GetBlendTerm(uint8_t alpha, uint32_t channel)
+    {
+        return ((channel & 0xFFFF) * alpha + 127) * 0x00010001;
+    }
+
+    // AlphaBlend() is (fg alpha + bg (255 - alpha) + 127) >> 8 a channel, under 1 << 15 before the shift
+    constexpr uint32_t BlendChannel2(uint32_t term, uint32_t weight, uint32_t channel)
+    {
+        return ((term + weight * channel) >> 8) & 0x00FF00FF;
+    }
+
+}
+
+    // One color blended over any background the way AlphaBlend() does, with the part of the color worked out
+    // once. Both take swapped pixels as the sprites hold them; Blend2() blends the two pixels of a word at once,
+    // a channel of both in a multiplication.
+    class Blender
+    {
+    public:
+        Blender() noexcept = default;
+
+        constexpr Blender(uint8_t alpha, uint16_t color) noexcept
+        : m_Red(detail::GetBlendTerm(alpha, detail::GetRed2(color)))
+        , m_Green(detail::GetBlendTerm(alpha, detail::GetGreen2(color)))
+        , m_Blue(detail::GetBlendTerm(alpha, detail::GetBlue2(color)))
+        , m_Weight(255 - alpha)
+        {
+        }
+
+        constexpr uint32_t Blend2(uint32_t pixels) const noexcept
+        {
+            return detail::MakePixels2(detail::BlendChannel2(m_Red, m_Weight, detail::GetRed2(pixels)),
+                                       detail::BlendChannel2(m_Green, m_Weight, detail::GetGreen2(pixels)),
+                                       detail::BlendChannel2(m_Blue, m_Weight, detail::GetBlue2(pixels)));
+        }
+
+        constexpr uint16_t Blend(uint16_t pixel) const noexcept
+        {
+            return static_cast<uint16_t>(Blend2(pixel));
+        }
+
+    private:
+        uint32_t m_Red;
+        uint32_t m_Green;
+        uint32_t m_Blue;
+        uint32_t m_Weight;
+    };
+
+namespace detail {
+
+    constexpr uint16_t SwapBytes(uint16_t color)
+    {
+        return static_cast<uint16_t>(color << 8 | color >> 8);
+    }
+
+    // Blender against AlphaBlend() for a pair of colors, both pixels of a word
+    constexpr bool IsBlenderExact(uint8_t alpha, uint16_t fg, uint16_t bg0, uint16_t bg1)
+    {
+        return Blender(alpha, SwapBytes(fg)).Blend2(static_cast<uint32_t>(SwapBytes(bg1)) << 16 | SwapBytes(bg0)) ==
+               (static_cast<uint32_t>(SwapBytes(AlphaBlend(alpha, fg, bg1))) << 16 | SwapBytes(AlphaBlend(alpha, fg, bg0)));
+    }
+
+    // a few pairs as a smoke test, CheckBlender() of the native build sweeps every alpha and color
+    static_assert(IsBlenderExact(0, 0xFFFF, 0x0000, 0xFFFF), "blender conformance");
+    static_assert(IsBlenderExact(255, 0xFFFF, 0x0000, 0x1234), "blender conformance");
+    static_assert(IsBlenderExact(150, 0xF800, 0x07E0, 0x001F), "blender conformance");
+    static_assert(IsBlenderExact(100, 0x0000, 0xFFFF, 0x8410), "blender conformance");
+    static_assert(IsBlenderExact(150, 0x07E0, 0xFFFF, 0x0000), "blender conformance");
+    static_assert(IsBlenderExact(128, 0x5AEB, 0xA514, 0x7BEF), "blender conformance");
+    static_assert(IsBlenderExact(1, 0xFFFF, 0xFFFF, 0x0841), "blender conformance");
+    static_assert(IsBlenderExact(254, 0x0841, 0xF7DE, 0xFFDF), "blender conformance");
+
+}
+
+}
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "Type.h"
+#include "GameOfLife.h"
+#include "StepKernel.h"
+#include "Parallel.h"
+#include "Random.h"
+
+namespace Gol3d {
+
+    // Universes independent cubes of six Col x Row faces stepped at once, bit u of a lane is the cell of universe u.
+    // The rule, the topologies and the halo cells are the same as the ones of GameOfLifeImpl.
+    //
+    // A face is stored as (Row + 2) x (Col + 2) lanes, the outer ring being the halo.
+    // All storage comes from the arena handed to the constructor.
+    template <uint32_t Rule, typename Lane = uint64_t>
+    class EnsembleImpl
+    {
+    public:
+        static const int Dimension = GameOfLifeDimension;
+        static const int Universes = sizeof(Lane) * 8;
+
+        // Bytes of arena needed for faces of col x row cells.
+        static constexpr size_t GetArenaSize(int col, int row) noexcept
+        {
+            return sizeof(Lane) * 2 * Dimension * (col + 2) * (row + 2);
+        }
+
+        // pArena must hold GetArenaSize(col, row) bytes aligned for Lane, and outlive the instance.
+        EnsembleImpl(int col, int row, void* pArena, long seed) noexcept
+        : m_Col(col)
+        , m_Row(row)
+        , m_Stride(col + 2)
+        , m_FaceLanes((col + 2) * (row + 2))
+        , m_Words(detail::GetWordCount(col))
+        {
+            std::memset(pArena, 0, GetArenaSize(col, row));
+            Lane* p = static_cast<Lane*>(pArena);
+            m_pGeneration[0] = p;
+            p += Dimension * m_FaceLanes;
+            m_pGeneration[1] = p;
+
+            Randomize(seed);
+        }
+
+        // Universe u starts as GameOfLifeImpl(col, row, pArena, seed + u) with the same density does.
+        void Randomize(long seed, uint32_t density = DefaultDensity) noexcept
+        {
+            Lane* pCurrent = m_pGeneration[m_Front];
+            std::memset(pCurrent, 0, sizeof(Lane) * Dimension * m_FaceLanes);
+            for (int u = 0; u < Universes; u++)
+            {
+                detail::Xoshiro128 rnd(seed + u);
+                for (int d = 0; d < Dimension; d++)
+                {
+                    for (int y = 0; y < m_Row; y++)
+                    {
+                        for (int w = 0; w < m_Words; w++)
+                        {
+                            const uint32_t word = detail::RandomWord(rnd, density);
+                            for (int x = w * 32; x < m_Col && x < w * 32 + 32; x++)
+                            {
+                                GetCell(pCurrent, d, x, y) |= static_cast<Lane>((word >> (x & 31)) & 1) << u;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        void Next() noexcept
+        {
+            ExchangeHalo();
+
+            if (m_pParallel != nullptr)
+            {
+                m_pParallel->For(Dimension, StepTask, this);
+            }
+            else
+            {
+                for (int d = 0; d < Dimension; d++)
+                {
+                    StepFace(d);
+                }
+            }
+
+            m_Front ^= 1;
+            m_Generation++;
+        }
+
+        // Writes the face d of the universe u to GetRow() rows of GetWordCount(GetCol()) words, stride words apart.
+        void CopyCurrent(int u, int d, uint32_t* pRows, int stride) const noexcept
+        {
+            const Lane* pFace = m_pGeneration[m_Front] + d * m_FaceLanes;
+            for (int y = 0; y < m_Row; y++)
+            {
+                const Lane* pRow = pFace + (y + 1) * m_Stride + 1;
+                uint32_t* pBits = pRows + y * stride;
+                std::memset(pBits, 0, sizeof(uint32_t) * m_Words);
+                for (int x = 0; x < m_Col; x++)
+                {
+                    pBits[x >> 5] |= static_cast<uint32_t>((pRow[x] >> u) & 1) << (x & 31);
+                }
+            }
+        }
+
+        // generations stepped since the start
+        uint64_t GetGeneration() const noexcept
+        {
+            return m_Generation;
+        }
+
+        // Replaces the cells of the face d of the universe u, bitmap has to be GetCol() x GetRow().
+        void SetCurrent(int u, int d, const Bitmap& bitmap) noexcept
+        {
+            Lane* pCurrent = m_pGeneration[m_Front];
+            for (int y = 0; y < m_Row; y++)
+            {
+                for (int x = 0; x < m_Col; x++)
+                {
+                    const Lane cell = (bitmap.pRows[y * bitmap.stride + (x >> 5)] >> (x & 31)) & 1;
+                    Lane& lane = GetCell(pCurrent, d, x, y);
+                    lane = (lane & ~(Lane(1) << u)) | (cell << u);
+                }
+            }
+        }
+
+        int GetCol() const noexcept
+        {
+            return m_Col;
+        }
+
+        int GetRow() const noexcept
+        {
+            return m_Row;
+        }
+
+        // Spreads Next() over the cores a face at a time, nullptr steps on the calling thread only.
+        void SetParallel(IParallel* pParallel) noexcept
+        {
+            m_pParallel = pParallel;
+        }
+
+        // The stitched topology needs square faces, it is ignored otherwise.
+        void SetTopology(Topology topology) noexcept
+        {
+            if (topology == Topology::Stitched && m_Col != m_Row)
+            {
+                return;
+            }
+            m_Topology = topology;
+        }
+
+    private:
+        Lane& GetCell(Lane* pGeneration, int d, int x, int y) const noexcept
+        {
+            return pGeneration[d * m_FaceLanes + (y + 1) * m_Stride + (x + 1)];
+        }
+
+        // the cell (x, y) of the face d, which may lie a cell beyond an edge (see detail::LocateCell())
+        Lane GetHaloCell(int d, int x, int y) noexcept
+        {
+            return detail::LocateCell(m_Topology, m_Col, m_Row, d, x, y) ? GetCell(m_pGeneration[m_Front], d, x, y) : Lane();
+        }
+
+        void ExchangeHalo() noexcept
+        {
+            Lane* pCurrent = m_pGeneration[m_Front];
+            for (int d = 0; d < Dimension; d++)
+            {
+                // the halo rows take the corners too, dead unless the face is a torus
+                for (int x = -1; x <= m_Col; x++)
+                {
+                    GetCell(pCurrent, d, x, -1) = GetHaloCell(d, x, -1);
+                    GetCell(pCurrent, d, x, m_Row) = GetHaloCell(d, x, m_Row);
+                }
+                for (int y = 0; y < m_Row; y++)
+                {
+                    GetCell(pCurrent, d, -1, y) = GetHaloCell(d, -1, y);
+                    GetCell(pCurrent, d, m_Col, y) = GetHaloCell(d, m_Col, y);
+                }
+            }
+        }
+
+        static void StepTask(void* pContext, int index) noexcept
+        {
+            static_cast<EnsembleImpl*>(pContext)->StepFace(index);
+        }
+
+        void StepFace(int d) noexcept
+        {
+            const Lane* pCurrent = m_pGeneration[m_Front] + d * m_FaceLanes;
+            Lane* pNext = m_pGeneration[m_Front ^ 1] + d * m_FaceLanes;
+            for (int y = 1; y <= m_Row; y++)
+            {
+                for (int x = 1; x <= m_Col; x++)
+                {
+                    const Lane* p = pCurrent + y * m_Stride + x;
+                    const Lane* pAbove = p - m_Stride;
+                    const Lane* pBelow = p + m_Stride;
+
+                    // the same adder tree as detail::NextWord, a lane holds one cell of every universe
+                    Lane aboveSum, aboveCarry, belowSum, belowCarry, rowSum, rowCarry;
+                    detail::FullAdd(pAbove[-1], pAbove[0], pAbove[1], aboveSum, aboveCarry);
+                    detail::FullAdd(pBelow[-1], pBelow[0], pBelow[1], belowSum, belowCarry);
+                    detail::HalfAdd(p[-1], p[1], rowSum, rowCarry);
+
+                    Lane s0, c0, t, c1, s1, c2, s2, s3;
+                    detail::FullAdd(aboveSum, belowSum, rowSum, s0, c0);
+                    detail::FullAdd(aboveCarry, belowCarry, rowCarry, t, c1);
+                    detail::HalfAdd(t, c0, s1, c2);
+                    detail::HalfAdd(c1, c2, s2, s3);
+
+                    pNext[y * m_Stride + x] = detail::RuleKernel<Rule, Lane>::Apply(*p, s0, s1, s2, s3);
+                }
+            }
+        }
+
+        int m_Col;
+        int m_Row;
+        int m_Stride;    // lanes per padded row
+        int m_FaceLanes; // lanes per padded face
+        int m_Words;     // words per row of a universe's face
+        Lane* m_pGeneration[2];
+        int m_Front = 0;
+        uint64_t m_Generation = 0;
+        IParallel* m_pParallel = nullptr;
+        Topology m_Topology = Topology::Torus;
+    };
+
+}
@@ -0,0 +1,1008 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "Type.h"
+#include "StepKernel.h"
+#include "Random.h"
+#include "Parallel.h"
+#include "History.h"
+
+namespace Gol3d {
+
+    // "B3/S23" style rulestring to a mask, bit n is born with n neighbors, bit 16 + n survives with n neighbors.
+    constexpr uint32_t ParseRule(const char* rule, int shift = 0, uint32_t mask = 0)
+    {
+        return *rule == '\0' ? mask :
+               (*rule == 'B' || *rule == 'b') ? ParseRule(rule + 1, 0, mask) :
+               (*rule == 'S' || *rule == 's') ? ParseRule(rule + 1, 16, mask) :
+               (*rule >= '0' && *rule <= '8') ? ParseRule(rule + 1, shift, mask | (1u << (shift + (*rule - '0')))) :
+               ParseRule(rule + 1, shift, mask);
+    }
+
+    constexpr const uint32_t ConwayRule = ParseRule("B3/S23");
+    constexpr const uint32_t HighLifeRule = ParseRule("B36/S23");
+    constexpr const uint32_t DayAndNightRule = ParseRule("B3678/S34678");
+    static_assert(ConwayRule == 0x000C0008, "ParseRule");
+
+namespace detail {
+
+    enum FaceEdge : uint8_t
+    {
+        EdgeTop,
+        EdgeRight,
+        EdgeBottom,
+        EdgeLeft,
+        EdgeCount
+    };
+
+    // The halo beyond an edge of a face is the border line (row 0, column Col - 1, ...)
+    // of another face, read forward or backward.
+    struct EdgeLink
+    {
+        uint8_t face;
+        uint8_t edge;
+        bool reversed;
+    };
+
+    // Every face wraps onto itself.
+    constexpr static const EdgeLink TorusEdgeLinks[GameOfLifeDimension][EdgeCount] = {
+        { { 0, EdgeBottom, false }, { 0, EdgeLeft, false }, { 0, EdgeTop, false }, { 0, EdgeRight, false } },
+        { { 1, EdgeBottom, false }, { 1, EdgeLeft, false }, { 1, EdgeTop, false }, { 1, EdgeRight, false } },
+        { { 2, EdgeBottom, false }, { 2, EdgeLeft, false }, { 2, EdgeTop, false }, { 2, EdgeRight, false } },
+        { { 3, EdgeBottom, false }, { 3, EdgeLeft, false }, { 3, EdgeTop, false }, { 3, EdgeRight, false } },
+        { { 4, EdgeBottom, false }, { 4, EdgeLeft, false }, { 4, EdgeTop, false }, { 4, EdgeRight, false } },
+        { { 5, EdgeBottom, false }, { 5, EdgeLeft, false }, { 5, EdgeTop, false }, { 5, EdgeRight, false } },
+    };
+
+    // Faces are joined along the real cube edges (see the vertices used by Cube::DrawSurface).
+    constexpr static const EdgeLink StitchedEdgeLinks[GameOfLifeDimension][EdgeCount] = {
+        { { 4, EdgeBottom, false }, { 1, EdgeLeft,   false }, { 5, EdgeTop,    false }, { 3, EdgeRight, false } },
+        { { 4, EdgeRight,  true  }, { 2, EdgeLeft,   false }, { 5, EdgeRight,  false }, { 0, EdgeRight, false } },
+        { { 4, EdgeTop,    true  }, { 3, EdgeLeft,   false }, { 5, EdgeBottom, true  }, { 1, EdgeRight, false } },
+        { { 4, EdgeLeft,   false }, { 0, EdgeLeft,   false }, { 5, EdgeLeft,   true  }, { 2, EdgeRight, false } },
+        { { 2, EdgeTop,    true  }, { 1, EdgeTop,    true  }, { 0, EdgeTop,    false }, { 3, EdgeTop,   false } },
+        { { 0, EdgeBottom, false }, { 1, EdgeBottom, false }, { 2, EdgeBottom, true  }, { 3, EdgeBottom, true  } },
+    };
+
+    // Moves the cell (x, y) of the face d of col x row cells, up to a face beyond an edge, onto the face behind
+    // the edge: its border line (see the links above) and the lines parallel to it further in. A torus face wraps
+    // diagonally past a corner, on the stitched cube three faces meet there and there is no such cell (false).
+    inline bool LocateCell(Topology topology, int col, int row, int& d, int& x, int& y) noexcept
+    {
+        const bool outX = x < 0 || x >= col;
+        const bool outY = y < 0 || y >= row;
+        if (!outX && !outY)
+        {
+            return true;
+        }
+        if (outX && outY)
+        {
+            x = (x + col) % col;
+            y = (y + row) % row;
+            return topology == Topology::Torus;
+        }
+
+        const int edge = y < 0 ? EdgeTop : x >= col ? EdgeRight : y >= row ? EdgeBottom : EdgeLeft;
+        const int depth = y < 0 ? -1 - y : x >= col ? x - col : y >= row ? y - row : -1 - x;
+        const EdgeLink& link = (topology == Topology::Torus ? TorusEdgeLinks : StitchedEdgeLinks)[d][edge];
+        const int i = outY ? x : y;
+        const int length = link.edge == EdgeTop || link.edge == EdgeBottom ? col : row;
+        const int k = link.reversed ? length - 1 - i : i;
+        d = link.face;
+        switch (link.edge)
+        {
+            case EdgeTop:
+                x = k;
+                y = depth;
+                return true;
+            case EdgeRight:
+                x = col - 1 - depth;
+                y = k;
+                return true;
+            case EdgeBottom:
+                x = k;
+                y = row - 1 - depth;
+                return true;
+            default:
+                x = depth;
+                y = k;
+                return true;
+        }
+    }
+
+    inline int CountTrailingZeros(uint32_t value) noexcept
+    {
+        return __builtin_ctz(value);
+    }
+
+}
+
+    // Six faces of Col x Row cells, each face is a torus or is stitched to its neighbors along the cube edges.
+    //
+    // A face is stored as Row + 2 padded rows (rows 0 and Row + 1 are the halo), every row as
+    // GetWordCount(Col) words followed by one pad word. The pad word between two rows holds the
+    // right halo cell of the upper row in bit 0 (when Col is a multiple of 32, in bit Col % 32 of
+    // the last word otherwise) and the left halo cell of the lower row in bit 31.
+    // All storage comes from the arena handed to the constructor.
+    template <uint32_t Rule>
+    class GameOfLifeImpl
+    {
+    public:
+        static const int Dimension = GameOfLifeDimension;
+        // A tile is a band of TileHeight rows, one word wide. Only tiles that changed in the last
+        // generation, or that border on one, are stepped again.
+        static const int TileHeight = 4;
+        static const int MinLength = 16;
+        static const int MaxLength = 4096;
+        static const int TaskBands = 16;
+
+        // Bytes of arena needed for faces of col x row cells (MinLength .. MaxLength).
+        static constexpr size_t GetArenaSize(int col, int row) noexcept
+        {
+            return sizeof(uint32_t) * (
+                2 * Dimension * GetFaceWordCount(col, row) +
+                Dimension * GetHaloWordCount(col, row) +
+                (Dimension * detail::EdgeCount + 1) * GetLineWordCount(col, row) +
+                2 * Dimension * GetTileWordCount(col, row)) +
+                sizeof(detail::StepCounts) * Dimension * GetTasksPerFace(row);
+        }
+
+        // pArena must hold GetArenaSize(col, row) bytes aligned for uint32_t, and outlive the instance.
+        GameOfLifeImpl(int col, int row, void* pArena, long seed) noexcept
+        : m_Col(col)
+        , m_Row(row)
+        , m_Words(detail::GetWordCount(col))
+        , m_Stride(detail::GetWordCount(col) + 1)
+        , m_FaceWords(GetFaceWordCount(col, row))
+        , m_Bands((row + TileHeight - 1) / TileHeight)
+        , m_TileWords(detail::GetWordCount(detail::GetWordCount(col)))
+        , m_LineWords(GetLineWordCount(col, row))
+        , m_LastMask((col & 31) == 0 ? ~0u : (1u << (col & 31)) - 1)
+        , m_StepBand(detail::GetStepBandFunction<Rule>(StepKernel::Auto))
+        , m_Rnd(seed)
+        {
+            std::memset(pArena, 0, GetArenaSize(col, row));
+            uint32_t* p = static_cast<uint32_t*>(pArena);
+            m_pGeneration[0] = p;
+            p += Dimension * m_FaceWords;
+            m_pGeneration[1] = p;
+            p += Dimension * m_FaceWords;
+            m_pHalo = p;
+            p += Dimension * GetHaloWordCount(col, row);
+            m_pLines = p;
+            p += (Dimension * detail::EdgeCount + 1) * m_LineWords;
+            m_pChangedTiles = p;
+            p += Dimension * m_Bands * m_TileWords;
+            m_pDirtyTiles = p;
+            p += Dimension * m_Bands * m_TileWords;
+            m_pTaskCounts = reinterpret_cast<detail::StepCounts*>(p);
+
+            Randomize();
+        }
+
+        // Returns false when no generation was stepped: randomized, paused or replayed from the cycle cache.
+        bool Next() noexcept
+        {
+            if ((m_State & 0x0010) == 0x0010)
+            {
+                Randomize();
+                m_State = (m_State & 0x0001);
+                return false;
+            }
+            else if ((m_State & 0x0001) == 0x0001)
+            {
+                return false;
+            }
+
+            // a confirmed cycle plays back from the cache, nothing has to be stepped
+            if (m_Period != 0)
+            {
+                m_Generation++;
+                if (m_AutoRandomize != 0 && ++m_Replayed >= m_AutoRandomize)
+                {
+                    Randomize();
+                }
+                else if (m_pHistory != nullptr)
+                {
+                    m_pHistory->Push(*this);
+                }
+                return false;
+            }
+
+            SpreadChangedTiles();
+            ExchangeHalo();
+
+            // Every task writes its own bands of the back buffer and of the changed tiles only,
+            // so the result does not depend on how the tasks are spread.
+            const int tasks = Dimension * GetTasksPerFace();
+            if (m_pParallel != nullptr)
+            {
+                m_pParallel->For(tasks, StepTask, this);
+            }
+            else
+            {
+                for (int i = 0; i < tasks; i++)
+                {
+                    StepTask(this, i);
+                }
+            }
+            UpdateStatistics();
+
+            if (m_pCycleStates != nullptr)
+            {
+                UpdateHash();
+            }
+            m_Front ^= 1;
+            m_Generation++;
+            RememberGeneration();
+            if (m_pHistory != nullptr)
+            {
+                m_pHistory->Push(*this);
+            }
+            return true;
+        }
+
+        // The rows stay untouched while Next() writes the following generation to the back buffer.
+        Bitmap GetCurrent(int d) const noexcept
+        {
+            return { GetCurrentFace(d) + GetRowOffset(1), m_Stride, m_Col, m_Row };
+        }
+
+        // Replaces the cells of the face d, bitmap has to be GetCol() x GetRow().
+        void SetCurrent(int d, const Bitmap& bitmap) noexcept
+        {
+            LeaveCycle();
+            uint32_t* pFace = GetFace(m_Front, d);
+            for (int y = 0; y < m_Row; y++)
+            {
+                uint32_t* pRow = pFace + GetRowOffset(y + 1);
+                std::memcpy(pRow, bitmap.pRows + y * bitmap.stride, sizeof(uint32_t) * m_Words);
+                pRow[m_Words - 1] &= m_LastMask;
+            }
+
+            // the back buffer of the face is stale, all its tiles have to be stepped
+            std::memset(m_pChangedTiles + d * m_Bands * m_TileWords, 0xFF, sizeof(uint32_t) * m_Bands * m_TileWords);
+            m_Statistics[d] = { CountLive(d), 0, 0, 0 };
+            ResetCycle();
+            m_Revision++;
+        }
+
+        // The live cells of the face d and the births and deaths that led to them, counted while stepping.
+        FaceStatistics GetStatistics(int d) const noexcept
+        {
+            return m_Period != 0 ? m_pCycleStatistics[GetReplaySlot() * Dimension + d] : m_Statistics[d];
+        }
+
+        // generations stepped or replayed since the start
+        uint64_t GetGeneration() const noexcept
+        {
+            return m_Generation;
+        }
+
+        // Counts the changes of the cells that are no generation (Randomize(), SetCurrent(), leaving a cycle),
+        // what was read from the faces is current as long as neither this nor GetGeneration() moves.
+        uint64_t GetRevision() const noexcept
+        {
+            return m_Revision;
+        }
+
+        int GetCol() const noexcept
+        {
+            return m_Col;
+        }
+
+        int GetRow() const noexcept
+        {
+            return m_Row;
+        }
+
+        void SetState(int state) noexcept
+        {
+            switch (state)
+            {
+                case 0:
+                    m_State = m_State & 0x1110;
+                    return;
+                case 1:
+                    m_State = m_State | 0x0001;
+                    return;
+                case 2:
+                    m_State = m_State | 0x0010;
+                    return;
+                default:
+                    return;
+            }
+        }
+
+        // The chance of a cell to start alive on Randomize(), in 1 / 65536 (see DensityFromPercent()).
+        void SetDensity(uint32_t density) noexcept
+        {
+            m_Density = density;
+        }
+
+        // The same seed and density give the same cells on the next Randomize().
+        void SetSeed(long seed) noexcept
+        {
+            m_Rnd.Seed(seed);
+        }
+
+        // Returns false when the CPU lacks the instructions of the kernel.
+        bool SetStepKernel(StepKernel kernel) noexcept
+        {
+            const auto stepBand = detail::GetStepBandFunction<Rule>(kernel);
+            if (stepBand == nullptr)
+            {
+                return false;
+            }
+            m_StepBand = stepBand;
+            return true;
+        }
+
+        // Spreads Next() over the cores, nullptr steps on the calling thread only.
+        void SetParallel(IParallel* pParallel) noexcept
+        {
+            m_pParallel = pParallel;
+        }
+
+        // The stitched topology needs square faces, it is ignored otherwise.
+        void SetTopology(Topology topology) noexcept
+        {
+            if (topology == Topology::Stitched && m_Col != m_Row)
+            {
+                return;
+            }
+            if (topology != m_Topology)
+            {
+                LeaveCycle();
+                m_Topology = topology;
+                ResetCycle();
+            }
+        }
+
+        // Bytes of cycle cache needed to look for cycles of up to length - 1 generations.
+        static constexpr size_t GetCycleCacheSize(int col, int row, int length) noexcept
+        {
+            return sizeof(uint64_t) * length + sizeof(FaceStatistics) * length * Dimension +
+                   sizeof(uint32_t) * length * Dimension * GetFaceWordCount(col, row);
+        }
+
+        // Keeps the last length generations in pCache (GetCycleCacheSize(col, row, length) bytes aligned
+        // for uint64_t), and once a generation equals one of them replays the cycle instead of stepping.
+        // nullptr stops looking for cycles.
+        void SetCycleCache(void* pCache, int length) noexcept
+        {
+            LeaveCycle();
+            m_pCycleHashes = static_cast<uint64_t*>(pCache);
+            m_pCycleStatistics = pCache == nullptr ? nullptr : reinterpret_cast<FaceStatistics*>(m_pCycleHashes + length);
+            m_pCycleStates = pCache == nullptr ? nullptr : reinterpret_cast<uint32_t*>(m_pCycleStatistics + length * Dimension);
+            m_CycleLength = pCache == nullptr ? 0 : length;
+            ResetCycle();
+        }
+
+        // Pushes the current generation and every following one to pHistory (a History of GetCol() x GetRow()
+        // faces), Randomize() starts it over. Cells replaced with SetCurrent() are pushed with the next generation.
+        // nullptr keeps no history.
+        void SetHistory(History* pHistory) noexcept
+        {
+            m_pHistory = pHistory;
+            if (pHistory != nullptr)
+            {
+                pHistory->Clear();
+                pHistory->Push(*this);
+            }
+        }
+
+        // Goes back to the generation of the age (0 is the newest pushed one), false when the history does not keep it.
+        bool Rewind(int age) noexcept
+        {
+            if (m_pHistory == nullptr || !m_pHistory->Rewind(age, *this))
+            {
+                return false;
+            }
+            m_Generation -= age;
+            ResetCycle();
+            return true;
+        }
+
+        // Randomizes once a cycle has been replayed for the given generations, 0 never does.
+        void SetAutoRandomize(int generations) noexcept
+        {
+            m_AutoRandomize = generations;
+        }
+
+        // the period of the cycle being replayed, 0 while stepping
+        int GetPeriod() const noexcept
+        {
+            return m_Period;
+        }
+
+        // Zobrist-like hash of the current cells, kept only with a cycle cache.
+        uint64_t GetHash() const noexcept
+        {
+            return m_Period != 0 ? m_pCycleHashes[GetReplaySlot()] : m_Hash;
+        }
+
+    private:
+        static constexpr int GetTasksPerFace(int row) noexcept
+        {
+            return ((row + TileHeight - 1) / TileHeight + TaskBands - 1) / TaskBands;
+        }
+
+        static constexpr int GetFaceWordCount(int col, int row) noexcept
+        {
+            return 1 + (row + 2) * (detail::GetWordCount(col) + 1);
+        }
+
+        // top and bottom rows, then the left and right columns including the corners
+        static constexpr int GetHaloWordCount(int col, int row) noexcept
+        {
+            return 2 * detail::GetWordCount(col) + 2 * detail::GetWordCount(row + 2);
+        }
+
+        static constexpr int GetLineWordCount(int col, int row) noexcept
+        {
+            return detail::GetWordCount(col > row ? col : row);
+        }
+
+        static constexpr int GetTileWordCount(int col, int row) noexcept
+        {
+            return ((row + TileHeight - 1) / TileHeight) * detail::GetWordCount(detail::GetWordCount(col));
+        }
+
+        uint32_t* GetFace(int generation, int d) const noexcept
+        {
+            return m_pGeneration[generation] + d * m_FaceWords;
+        }
+
+        // the first word of the padded row r, its pad word is the one before
+        int GetRowOffset(int r) const noexcept
+        {
+            return 1 + r * m_Stride;
+        }
+
+        void Randomize() noexcept
+        {
+            // whole words of cells, face after face in memory order
+            uint32_t* pCurrent = m_pGeneration[m_Front ^ 1];
+            std::memset(pCurrent, 0, sizeof(uint32_t) * Dimension * m_FaceWords);
+            for (int d = 0; d < Dimension; d++)
+            {
+                for (int y = 0; y < m_Row; y++)
+                {
+                    uint32_t* pRow = pCurrent + d * m_FaceWords + GetRowOffset(y + 1);
+                    for (int w = 0; w < m_Words; w++)
+                    {
+                        pRow[w] = detail::RandomWord(m_Rnd, m_Density);
+                    }
+                    pRow[m_Words - 1] &= m_LastMask;
+                }
+            }
+
+            std::memset(m_pChangedTiles, 0xFF, sizeof(uint32_t) * Dimension * m_Bands * m_TileWords);
+            m_Front ^= 1;
+            m_Period = 0;
+            for (int d = 0; d < Dimension; d++)
+            {
+                m_Statistics[d] = { CountLive(d), 0, 0, 0 };
+            }
+            ResetCycle();
+            m_Revision++;
+            if (m_pHistory != nullptr)
+            {
+                m_pHistory->Clear();
+                m_pHistory->Push(*this);
+            }
+        }
+
+        // the face the cells are read from, the cached one while a cycle is replayed
+        const uint32_t* GetCurrentFace(int d) const noexcept
+        {
+            return m_Period != 0 ? GetCycleState(GetReplaySlot()) + d * m_FaceWords : GetFace(m_Front, d);
+        }
+
+        uint32_t* GetCycleState(int slot) const noexcept
+        {
+            return m_pCycleStates + slot * Dimension * m_FaceWords;
+        }
+
+        // The cycle is made of the cached generations m_CycleEnd - m_Period + 1 .. m_CycleEnd.
+        int GetReplaySlot() const noexcept
+        {
+            const int phase = static_cast<int>((m_Generation - m_CycleEnd) % m_Period);
+            return static_cast<int>((phase == 0 ? m_CycleEnd : m_CycleEnd - m_Period + phase) % m_CycleLength);
+        }
+
+        // A word of cells hashes to 0 when all of them are dead, anything else is mixed with its position.
+        static uint64_t HashWord(int index, uint32_t word) noexcept
+        {
+            if (word == 0)
+            {
+                return 0;
+            }
+            uint64_t h = (static_cast<uint64_t>(index) << 32) | word;
+            h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+            h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+            return h ^ (h >> 31);
+        }
+
+        // Forgets the cached generations and starts over from the current one.
+        void ResetCycle() noexcept
+        {
+            if (m_pCycleStates == nullptr)
+            {
+                return;
+            }
+
+            m_Hash = 0;
+            for (int d = 0; d < Dimension; d++)
+            {
+                const uint32_t* pFace = GetFace(m_Front, d);
+                for (int y = 1; y <= m_Row; y++)
+                {
+                    for (int w = 0; w < m_Words; w++)
+                    {
+                        const int index = d * m_FaceWords + GetRowOffset(y) + w;
+                        m_Hash ^= HashWord(index, pFace[GetRowOffset(y) + w] & (w == m_Words - 1 ? m_LastMask : ~0u));
+                    }
+                }
+            }
+            m_CycleOrigin = m_Generation;
+            RememberGeneration();
+        }
+
+        // Continues stepping from the generation being replayed.
+        void LeaveCycle() noexcept
+        {
+            if (m_Period == 0)
+            {
+                return;
+            }
+
+            std::memcpy(m_pGeneration[m_Front], GetCycleState(GetReplaySlot()), sizeof(uint32_t) * Dimension * m_FaceWords);
+            std::memcpy(m_Statistics, m_pCycleStatistics + GetReplaySlot() * Dimension, sizeof(m_Statistics));
+            std::memset(m_pChangedTiles, 0xFF, sizeof(uint32_t) * Dimension * m_Bands * m_TileWords);
+            m_Period = 0;
+            ResetCycle();
+            m_Revision++;
+        }
+
+        // Only words of the tiles that changed can change the hash.
+        void UpdateHash() noexcept
+        {
+            for (int d = 0; d < Dimension; d++)
+            {
+                const uint32_t* pCurrent = GetFace(m_Front, d);
+                const uint32_t* pNext = GetFace(m_Front ^ 1, d);
+                const uint32_t* pChanged = m_pChangedTiles + d * m_Bands * m_TileWords;
+                for (int b = 0; b < m_Bands; b++)
+                {
+                    const int rowBegin = 1 + b * TileHeight;
+                    const int rowEnd = rowBegin + TileHeight <= m_Row + 1 ? rowBegin + TileHeight : m_Row + 1;
+                    for (int w = 0; w < m_TileWords; w++)
+                    {
+                        for (uint32_t tiles = pChanged[b * m_TileWords + w]; tiles != 0; tiles &= tiles - 1)
+                        {
+                            const int i = w * 32 + detail::CountTrailingZeros(tiles);
+                            const uint32_t mask = i == m_Words - 1 ? m_LastMask : ~0u;
+                            for (int r = rowBegin; r < rowEnd; r++)
+                            {
+                                const int offset = GetRowOffset(r) + i;
+                                m_Hash ^= HashWord(d * m_FaceWords + offset, pCurrent[offset] & mask) ^
+                                          HashWord(d * m_FaceWords + offset, pNext[offset] & mask);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // Caches the current generation and looks for it among the cached ones, the shortest period wins.
+        void RememberGeneration() noexcept
+        {
+            if (m_pCycleStates == nullptr)
+            {
+                return;
+            }
+
+            const int slot = static_cast<int>(m_Generation % m_CycleLength);
+            uint32_t* pState = GetCycleState(slot);
+            std::memcpy(pState, m_pGeneration[m_Front], sizeof(uint32_t) * Dimension * m_FaceWords);
+            std::memcpy(m_pCycleStatistics + slot * Dimension, m_Statistics, sizeof(m_Statistics));
+            m_pCycleHashes[slot] = m_Hash;
+
+            for (int p = 1; p < m_CycleLength && static_cast<uint64_t>(p) <= m_Generation - m_CycleOrigin; p++)
+            {
+                const int other = static_cast<int>((m_Generation - p) % m_CycleLength);
+                if (m_pCycleHashes[other] == m_Hash && IsSameCells(pState, GetCycleState(other)))
+                {
+                    m_Period = p;
+                    m_CycleEnd = m_Generation;
+                    m_Replayed = 0;
+                    return;
+                }
+            }
+        }
+
+        // compares the cells only, the halo of the cached generations may differ
+        bool IsSameCells(const uint32_t* pLeft, const uint32_t* pRight) const noexcept
+        {
+            for (int d = 0; d < Dimension; d++)
+            {
+                for (int y = 1; y <= m_Row; y++)
+                {
+                    const int offset = d * m_FaceWords + GetRowOffset(y);
+                    if (m_Words > 1 && std::memcmp(pLeft + offset, pRight + offset, sizeof(uint32_t) * (m_Words - 1)) != 0)
+                    {
+                        return false;
+                    }
+                    if (((pLeft[offset + m_Words - 1] ^ pRight[offset + m_Words - 1]) & m_LastMask) != 0)
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        // Large faces are split into tasks of up to TaskBands bands so that the cores stay busy.
+        int GetTasksPerFace() const noexcept
+        {
+            return GetTasksPerFace(m_Row);
+        }
+
+        static void StepTask(void* pContext, int index) noexcept
+        {
+            auto& self = *static_cast<GameOfLifeImpl*>(pContext);
+            const int tasksPerFace = self.GetTasksPerFace();
+            const int d = index / tasksPerFace;
+            const int bandBegin = (index % tasksPerFace) * TaskBands;
+            const int bandEnd = bandBegin + TaskBands < self.m_Bands ? bandBegin + TaskBands : self.m_Bands;
+            detail::StepCounts& counts = self.m_pTaskCounts[index];
+            counts = { 0, 0 };
+            self.StepBands(d, bandBegin, bandEnd, counts);
+        }
+
+        void StepBands(int d, int bandBegin, int bandEnd, detail::StepCounts& counts) noexcept
+        {
+            const uint32_t* pCurrent = GetFace(m_Front, d);
+            uint32_t* pNext = GetFace(m_Front ^ 1, d);
+            const uint32_t* pDirty = m_pDirtyTiles + d * m_Bands * m_TileWords;
+            uint32_t* pChanged = m_pChangedTiles + d * m_Bands * m_TileWords;
+
+            for (int b = bandBegin; b < bandEnd; b++)
+            {
+                const int rowBegin = 1 + b * TileHeight;
+                const int rows = rowBegin + TileHeight <= m_Row + 1 ? TileHeight : m_Row + 1 - rowBegin;
+                const uint32_t* pDirtyBand = pDirty + b * m_TileWords;
+                uint32_t* pChangedBand = pChanged + b * m_TileWords;
+                std::memset(pChangedBand, 0, sizeof(uint32_t) * m_TileWords);
+
+                // Tiles that are not dirty are skipped: the back buffer holds the previous generation,
+                // and a tile that is not dirty did not change since.
+                int end = 0;
+                for (int begin = FindBit(pDirtyBand, 0, true); begin < m_Words; begin = FindBit(pDirtyBand, end, true))
+                {
+                    end = FindBit(pDirtyBand, begin, false);
+                    const int fullEnd = end == m_Words && m_LastMask != ~0u ? end - 1 : end;
+                    const int offset = GetRowOffset(rowBegin);
+                    if (fullEnd > begin)
+                    {
+                        m_StepBand(pCurrent + offset + begin, pNext + offset + begin, m_Stride, rows, fullEnd - begin, pChangedBand, begin, counts);
+                    }
+                    if (fullEnd < end)
+                    {
+                        StepLastWord(pCurrent + offset + fullEnd, pNext + offset + fullEnd, rows, pChangedBand, counts);
+                    }
+                }
+            }
+        }
+
+        // the last word of a row that is only partly made of cells
+        void StepLastWord(const uint32_t* pCurrent, uint32_t* pNext, int rows, uint32_t* pChanged, detail::StepCounts& counts) const noexcept
+        {
+            uint32_t changed = 0;
+            for (int r = 0; r < rows; r++)
+            {
+                const uint32_t* pWord = pCurrent + r * m_Stride;
+                const uint32_t current = *pWord & m_LastMask;
+                const uint32_t next = detail::NextWord<Rule, uint32_t>(pWord - m_Stride, pWord, pWord + m_Stride) & m_LastMask;
+                detail::CountChanges(current, next, next ^ current, counts);
+                changed |= next ^ current;
+                pNext[r * m_Stride] = next;
+            }
+            if (changed != 0)
+            {
+                pChanged[(m_Words - 1) >> 5] |= 1u << ((m_Words - 1) & 31);
+            }
+        }
+
+        // Adds up the births and deaths of the tasks of every face, the live cells follow from them.
+        void UpdateStatistics() noexcept
+        {
+            const int tasksPerFace = GetTasksPerFace();
+            for (int d = 0; d < Dimension; d++)
+            {
+                uint32_t births = 0;
+                uint32_t deaths = 0;
+                for (int i = d * tasksPerFace; i < (d + 1) * tasksPerFace; i++)
+                {
+                    births += m_pTaskCounts[i].births;
+                    deaths += m_pTaskCounts[i].deaths;
+                }
+                m_Statistics[d] = { m_Statistics[d].live + births - deaths, births, deaths, births + deaths };
+            }
+        }
+
+        // the live cells of the face d counted from scratch, for cells that were not stepped there
+        uint32_t CountLive(int d) const noexcept
+        {
+            const uint32_t* pFace = GetFace(m_Front, d);
+            uint32_t live = 0;
+            for (int y = 1; y <= m_Row; y++)
+            {
+                const uint32_t* pRow = pFace + GetRowOffset(y);
+                for (int w = 0; w < m_Words; w++)
+                {
+                    live += __builtin_popcount(w == m_Words - 1 ? pRow[w] & m_LastMask : pRow[w]);
+                }
+            }
+            return live;
+        }
+
+        // the first tile column from begin whose bit is set (or clear), m_Words if there is none
+        int FindBit(const uint32_t* pTiles, int begin, bool set) const noexcept
+        {
+            for (int i = begin; i < m_Words; i = (i & ~31) + 32)
+            {
+                const uint32_t tiles = (set ? pTiles[i >> 5] : ~pTiles[i >> 5]) & (~0u << (i & 31));
+                if (tiles != 0)
+                {
+                    const int found = (i & ~31) + detail::CountTrailingZeros(tiles);
+                    return found < m_Words ? found : m_Words;
+                }
+            }
+            return m_Words;
+        }
+
+        // A tile is dirty when a tile around it changed in the last generation.
+        void SpreadChangedTiles() noexcept
+        {
+            for (int d = 0; d < Dimension; d++)
+            {
+                const uint32_t* pChanged = m_pChangedTiles + d * m_Bands * m_TileWords;
+                uint32_t* pDirty = m_pDirtyTiles + d * m_Bands * m_TileWords;
+                for (int b = 0; b < m_Bands; b++)
+                {
+                    for (int w = 0; w < m_TileWords; w++)
+                    {
+                        const uint32_t tiles = ChangedAround(pChanged, b, w);
+                        const uint32_t left = w > 0 ? ChangedAround(pChanged, b, w - 1) >> 31 : 0;
+                        const uint32_t right = w + 1 < m_TileWords ? ChangedAround(pChanged, b, w + 1) << 31 : 0;
+                        pDirty[b * m_TileWords + w] = tiles | (tiles << 1) | (tiles >> 1) | left | right;
+                    }
+                }
+            }
+        }
+
+        uint32_t ChangedAround(const uint32_t* pChanged, int b, int w) const noexcept
+        {
+            return pChanged[b * m_TileWords + w] |
+                   (b > 0 ? pChanged[(b - 1) * m_TileWords + w] : 0) |
+                   (b + 1 < m_Bands ? pChanged[(b + 1) * m_TileWords + w] : 0);
+        }
+
+        void MarkDirty(int d, int b, int i) noexcept
+        {
+            if (b >= 0 && b < m_Bands && i >= 0 && i < m_Words)
+            {
+                m_pDirtyTiles[(d * m_Bands + b) * m_TileWords + (i >> 5)] |= 1u << (i & 31);
+            }
+        }
+
+        // Fills rows 0 and Row + 1 and the left / right halo cells of every face from its neighbors,
+        // so that the kernel never has to know how the faces are connected.
+        // Tiles next to halo cells that differ from the last generation are marked dirty.
+        void ExchangeHalo() noexcept
+        {
+            const int lastWord = m_Words - 1;
+            const int lastBit = (m_Col - 1) & 31;
+            for (int d = 0; d < Dimension; d++)
+            {
+                const uint32_t* pFace = GetFace(m_Front, d);
+                uint32_t* pTop = GetLine(d, detail::EdgeTop);
+                uint32_t* pRight = GetLine(d, detail::EdgeRight);
+                uint32_t* pBottom = GetLine(d, detail::EdgeBottom);
+                uint32_t* pLeft = GetLine(d, detail::EdgeLeft);
+                std::memcpy(pTop, pFace + GetRowOffset(1), sizeof(uint32_t) * m_Words);
+                std::memcpy(pBottom, pFace + GetRowOffset(m_Row), sizeof(uint32_t) * m_Words);
+                pTop[lastWord] &= m_LastMask;
+                pBottom[lastWord] &= m_LastMask;
+                std::memset(pLeft, 0, sizeof(uint32_t) * m_LineWords);
+                std::memset(pRight, 0, sizeof(uint32_t) * m_LineWords);
+                for (int y = 0; y < m_Row; y++)
+                {
+                    const uint32_t* pRow = pFace + GetRowOffset(y + 1);
+                    pLeft[y >> 5] |= (pRow[0] & 1) << (y & 31);
+                    pRight[y >> 5] |= ((pRow[lastWord] >> lastBit) & 1) << (y & 31);
+                }
+            }
+
+            const auto& links = m_Topology == Topology::Torus ? detail::TorusEdgeLinks : detail::StitchedEdgeLinks;
+            const int haloColumnWords = detail::GetWordCount(m_Row + 2);
+            for (int d = 0; d < Dimension; d++)
+            {
+                uint32_t* pFace = GetFace(m_Front, d);
+                uint32_t* pHaloTop = m_pHalo + d * GetHaloWordCount(m_Col, m_Row);
+                uint32_t* pHaloBottom = pHaloTop + m_Words;
+                uint32_t* pHaloLeft = pHaloBottom + m_Words;
+                uint32_t* pHaloRight = pHaloLeft + haloColumnWords;
+
+                ExchangeHaloRow(d, GetLinkedLine(links[d][detail::EdgeTop], m_Col), pHaloTop, pFace + GetRowOffset(0), 0);
+                ExchangeHaloRow(d, GetLinkedLine(links[d][detail::EdgeBottom], m_Col), pHaloBottom, pFace + GetRowOffset(m_Row + 1), m_Bands - 1);
+                ExchangeHaloColumn(d, GetLinkedLine(links[d][detail::EdgeLeft], m_Row), pHaloLeft, 0);
+                ExchangeHaloColumn(d, GetLinkedLine(links[d][detail::EdgeRight], m_Row), pHaloRight, lastWord);
+
+                // write the halo columns into the pad words (and the last word of every row when Col % 32 != 0)
+                const int tail = m_Col & 31;
+                uint32_t previousRight = 0;
+                for (int r = 0; r < m_Row + 2; r++)
+                {
+                    const uint32_t left = (pHaloLeft[r >> 5] >> (r & 31)) & 1;
+                    const uint32_t right = (pHaloRight[r >> 5] >> (r & 31)) & 1;
+                    pFace[r * m_Stride] = (left << 31) | previousRight;
+                    if (tail == 0)
+                    {
+                        previousRight = right;
+                    }
+                    else
+                    {
+                        uint32_t& last = pFace[GetRowOffset(r) + lastWord];
+                        last = (last & m_LastMask) | (right << tail);
+                    }
+                }
+                pFace[(m_Row + 2) * m_Stride] = previousRight;
+            }
+        }
+
+        void ExchangeHaloRow(int d, const uint32_t* pLine, uint32_t* pHalo, uint32_t* pRow, int band) noexcept
+        {
+            for (int i = 0; i < m_Words; i++)
+            {
+                if (pLine[i] != pHalo[i])
+                {
+                    pHalo[i] = pLine[i];
+                    MarkDirty(d, band, i - 1);
+                    MarkDirty(d, band, i);
+                    MarkDirty(d, band, i + 1);
+                }
+                pRow[i] = pLine[i];
+            }
+        }
+
+        // pHalo has a bit per padded row, rows 0 and Row + 1 being the corners
+        void ExchangeHaloColumn(int d, const uint32_t* pLine, uint32_t* pHalo, int column) noexcept
+        {
+            const int words = detail::GetWordCount(m_Row + 2);
+            for (int k = 0; k < words; k++)
+            {
+                uint32_t halo = (k < m_LineWords ? pLine[k] << 1 : 0) | (k > 0 && k - 1 < m_LineWords ? pLine[k - 1] >> 31 : 0);
+                if (m_Topology == Topology::Torus)
+                {
+                    // diagonal neighbors of the corner cells, three faces meet at a cube corner so they stay dead otherwise
+                    if (k == 0)
+                    {
+                        halo |= (pLine[(m_Row - 1) >> 5] >> ((m_Row - 1) & 31)) & 1;
+                    }
+                    if (k == ((m_Row + 1) >> 5))
+                    {
+                        halo |= (pLine[0] & 1) << ((m_Row + 1) & 31);
+                    }
+                }
+
+                // padded row r touches the face rows r - 2 .. r
+                for (uint32_t changed = halo ^ pHalo[k]; changed != 0; changed &= changed - 1)
+                {
+                    const int r = k * 32 + detail::CountTrailingZeros(changed);
+                    for (int y = r - 2; y <= r; y++)
+                    {
+                        if (y >= 0 && y < m_Row)
+                        {
+                            MarkDirty(d, y / TileHeight, column);
+                        }
+                    }
+                }
+                pHalo[k] = halo;
+            }
+        }
+
+        uint32_t* GetLine(int d, int edge) const noexcept
+        {
+            return m_pLines + (d * detail::EdgeCount + edge) * m_LineWords;
+        }
+
+        // the border line the link points to, reversed into the spare line when needed
+        const uint32_t* GetLinkedLine(const detail::EdgeLink& link, int length) const noexcept
+        {
+            const uint32_t* pLine = GetLine(link.face, link.edge);
+            if (!link.reversed)
+            {
+                return pLine;
+            }
+
+            uint32_t* pReversed = GetLine(Dimension, 0);
+            const int words = detail::GetWordCount(length);
+            for (int i = 0; i < words; i++)
+            {
+                pReversed[i] = Reverse(pLine[words - 1 - i]);
+            }
+            const int shift = words * 32 - length;
+            if (shift != 0)
+            {
+                for (int i = 0; i < words; i++)
+                {
+                    pReversed[i] = (pReversed[i] >> shift) | (i + 1 < words ? pReversed[i + 1] << (32 - shift) : 0);
+                }
+            }
+            return pReversed;
+        }
+
+        static uint32_t Reverse(uint32_t value) noexcept
+        {
+            value = ((value >> 1) & 0x55555555) | ((value & 0x55555555) << 1);
+            value = ((value >> 2) & 0x33333333) | ((value & 0x33333333) << 2);
+            value = ((value >> 4) & 0x0F0F0F0F) | ((value & 0x0F0F0F0F) << 4);
+            value = ((value >> 8) & 0x00FF00FF) | ((value & 0x00FF00FF) << 8);
+            return (value >> 16) | (value << 16);
+        }
+
+    private:
+        const int m_Col;
+        const int m_Row;
+        const int m_Words;
+        const int m_Stride;
+        const int m_FaceWords;
+        const int m_Bands;
+        const int m_TileWords;
+        const int m_LineWords;
+        const uint32_t m_LastMask;
+        detail::StepBandFunction m_StepBand;
+        IParallel* m_pParallel = nullptr;
+
+        // m_pGeneration[m_Front] is the current generation, the other one receives the next generation.
+        uint32_t* m_pGeneration[2];
+        int m_Front = 0;
+        // the last halo of every face, to find the tiles it touched
+        uint32_t* m_pHalo;
+        // border lines of every face plus a spare one for reversed lines
+        uint32_t* m_pLines;
+        // a bit per tile, band by band
+        uint32_t* m_pChangedTiles;
+        uint32_t* m_pDirtyTiles;
+        // the births and deaths of every task of the last Next()
+        detail::StepCounts* m_pTaskCounts;
+        FaceStatistics m_Statistics[Dimension];
+
+        detail::Xoshiro128 m_Rnd;
+        uint32_t m_Density = DefaultDensity;
+        int m_State = 0; // bit1: 0 = Start, 1 = Pause, bit2: Randomize
+
+        // the last m_CycleLength generations, slot g % m_CycleLength holds the generation g
+        uint64_t* m_pCycleHashes = nullptr;
+        FaceStatistics* m_pCycleStatistics = nullptr;
+        uint32_t* m_pCycleStates = nullptr;
+        int m_CycleLength = 0;
+        int m_Period = 0;
+        int m_AutoRandomize = 0;
+        int m_Replayed = 0;
+        History* m_pHistory = nullptr;
+        uint64_t m_Generation = 0;
+        uint64_t m_Revision = 0;
+        uint64_t m_CycleOrigin = 0; // the first generation cached since the last change
+        uint64_t m_CycleEnd = 0;    // the generation a cycle was found at
+        uint64_t m_Hash = 0;
+        Topology m_Topology = Topology::Torus;
+    };
+
+}
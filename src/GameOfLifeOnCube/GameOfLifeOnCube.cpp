@@ -1,161 +1,200 @@
-#include <cstring>
-#include <random>
+#include <atomic>
 #include "Type.h"
+#include "GameOfLife.h"
+#include "Generations.h"
+#include "LargerThanLife.h"
 #include "../GameOfLifeOnCube.h"
 
 namespace Gol3d{
 
 namespace {
 
-    static const int GameOfLifeDimension = 6;
+    constexpr const int GameOfLifeCol = 32;
+    constexpr const int GameOfLifeRow = 32;
+    constexpr const int CycleCacheLength = 16; // periods up to 15 (pulsar 3, pentadecathlon 15)
+    constexpr const int BenchmarkGenerations = 64;
+    std::atomic<uint32_t> g_GenerationCount(0);
+#if defined(GOL3D_BRIANS_BRAIN)
+    typedef GenerationsImpl<BriansBrainRule, 3> GameOfLife;
+#elif defined(GOL3D_STAR_WARS)
+    typedef GenerationsImpl<StarWarsRule, 4> GameOfLife;
+#elif defined(GOL3D_BUGS)
+    typedef LargerThanLifeImpl<BugsRule> GameOfLife;
+#elif defined(GOL3D_MAJORITY)
+    typedef LargerThanLifeImpl<MajorityRule> GameOfLife;
+#else
+    typedef GameOfLifeImpl<ConwayRule> GameOfLife;
+#endif
 
-    template <int Col, int Row>
-    class GameOfLifeImpl
+    GameOfLife& GetGameOfLife(long seed)
     {
-    public:
-        static const int Dimension = GameOfLifeDimension;
+        alignas(4) static uint8_t s_Arena[GameOfLife::GetArenaSize(GameOfLifeCol, GameOfLifeRow)];
+        static GameOfLife s_GameOfLife(GameOfLifeCol, GameOfLifeRow, s_Arena, seed);
+        return s_GameOfLife;
+    }
 
-        GameOfLifeImpl(long seed) noexcept
-        : m_Rnd(seed)
-        {        
-            Randomize();
-        }
+    GameOfLife& GetGameOfLife()
+    {
+        return GetGameOfLife(0);
+    }
+
+    template <uint32_t Rule>
+    StateBitmap GetStates(const GameOfLifeImpl<Rule>& gameOfLife, int d) noexcept
+    {
+        return { { gameOfLife.GetCurrent(d) }, 1, 2 };
+    }
+
+    template <uint32_t Rule, int States>
+    StateBitmap GetStates(const GenerationsImpl<Rule, States>& gameOfLife, int d) noexcept
+    {
+        return gameOfLife.GetStates(d);
+    }
+
+    template <uint64_t Rule>
+    StateBitmap GetStates(const LargerThanLifeImpl<Rule>& gameOfLife, int d) noexcept
+    {
+        return { { gameOfLife.GetCurrent(d) }, 1, 2 };
+    }
+
+    template <uint32_t Rule>
+    void SetCycleCache(GameOfLifeImpl<Rule>& gameOfLife) noexcept
+    {
+        alignas(8) static uint8_t s_CycleCache[GameOfLifeImpl<Rule>::GetCycleCacheSize(GameOfLifeCol, GameOfLifeRow, CycleCacheLength)];
+        gameOfLife.SetCycleCache(s_CycleCache, CycleCacheLength);
+    }
+
+    // decaying cells rarely settle into short cycles
+    template <uint32_t Rule, int States>
+    void SetCycleCache(GenerationsImpl<Rule, States>&) noexcept
+    {
+    }
+
+    // no cycle cache, the cells are stepped a face at a time anyway
+    template <uint64_t Rule>
+    void SetCycleCache(LargerThanLifeImpl<Rule>&) noexcept
+    {
+    }
+
+    template <uint32_t Rule>
+    void SetStepKernel(GameOfLifeImpl<Rule>& gameOfLife, StepKernel kernel) noexcept
+    {
+        gameOfLife.SetStepKernel(kernel);
+    }
+
+    template <uint32_t Rule, int States>
+    void SetStepKernel(GenerationsImpl<Rule, States>&, StepKernel) noexcept
+    {
+    }
+
+    template <uint64_t Rule>
+    void SetStepKernel(LargerThanLifeImpl<Rule>&, StepKernel) noexcept
+    {
+    }
+
+    // true when the step to the current generation left the cells of the face d as they were
+    template <uint32_t Rule>
+    bool IsFaceUnchanged(const GameOfLifeImpl<Rule>& gameOfLife, int d) noexcept
+    {
+        return gameOfLife.GetStatistics(d).changed == 0;
+    }
+
+    // no births and deaths are counted, a face may have changed with every step
+    template <uint32_t Rule, int States>
+    bool IsFaceUnchanged(const GenerationsImpl<Rule, States>&, int) noexcept
+    {
+        return false;
+    }
+
+    template <uint64_t Rule>
+    bool IsFaceUnchanged(const LargerThanLifeImpl<Rule>&, int) noexcept
+    {
+        return false;
+    }
 
-        void Next() noexcept
+    // the same soup for every kernel, on an instance of its own so that the cube is left alone
+    template <uint32_t Rule>
+    StepKernel BenchmarkStepKernels(const GameOfLifeImpl<Rule>*, GetMicros getMicros, IParallel* pParallel, ReportStepKernel report) noexcept
+    {
+        static const StepKernel Kernels[] = { StepKernel::Portable, StepKernel::LookupTable };
+        alignas(4) static uint8_t s_Arena[GameOfLifeImpl<Rule>::GetArenaSize(GameOfLifeCol, GameOfLifeRow)];
+
+        StepKernel fastest = StepKernel::Auto;
+        unsigned long fastestMicroseconds = 0;
+        for (const StepKernel kernel : Kernels)
         {
-            if ((m_State & 0x0010) == 0x0010)
+            GameOfLifeImpl<Rule> gameOfLife(GameOfLifeCol, GameOfLifeRow, s_Arena, 0);
+            gameOfLife.SetTopology(Topology::Stitched);
+            gameOfLife.SetParallel(pParallel);
+            if (!gameOfLife.SetStepKernel(kernel))
             {
-                Randomize();
-                m_State = (m_State & 0x0001);
-                return;
+                continue;
             }
-            else if ((m_State & 0x0001) == 0x0001)
+
+            const unsigned long start = getMicros();
+            for (int i = 0; i < BenchmarkGenerations; i++)
             {
-                return;
+                gameOfLife.Next();
             }
-
-            for (int d = Dimension - 1; d >= 0; d--)
+            const unsigned long microseconds = (getMicros() - start) / BenchmarkGenerations;
+            if (report != nullptr)
             {
-                for (int y = 0; y < Row; y++)
-                {
-                    for (int x = 0; x < Col; x++)
-                    {
-                        int neighborAliveCount = 0;
-                        {
-                            const int ul = WrapAround(y - 1, Row) * Col + WrapAround(x - 1, Col);
-                            const int um = WrapAround(y - 1, Row) * Col + WrapAround(x    , Col);
-                            const int ur = WrapAround(y - 1, Row) * Col + WrapAround(x + 1, Col);
-                            const int ml = WrapAround(y    , Row) * Col + WrapAround(x - 1, Col);
-                            const int mr = WrapAround(y    , Row) * Col + WrapAround(x + 1, Col);
-                            const int dl = WrapAround(y + 1, Row) * Col + WrapAround(x - 1, Col);
-                            const int dm = WrapAround(y + 1, Row) * Col + WrapAround(x    , Col);
-                            const int dr = WrapAround(y + 1, Row) * Col + WrapAround(x + 1, Col);
-
-                            if (m_Current[d][ul]) neighborAliveCount++;
-                            if (m_Current[d][um]) neighborAliveCount++;
-                            if (m_Current[d][ur]) neighborAliveCount++;
-                            if (m_Current[d][ml]) neighborAliveCount++;
-                            if (m_Current[d][mr]) neighborAliveCount++;
-                            if (m_Current[d][dl]) neighborAliveCount++;
-                            if (m_Current[d][dm]) neighborAliveCount++;
-                            if (m_Current[d][dr]) neighborAliveCount++;
-                        }
-
-                        if (m_Current[d][y * Col + x] &&
-                            (neighborAliveCount == 2 || neighborAliveCount == 3))
-                        {
-                            m_Next[d][y * Col + x] = true;
-                        }
-                        else if (!m_Current[d][y * Col + x] &&
-                                neighborAliveCount == 3)
-                        {
-                            m_Next[d][y * Col + x] = true;
-                        }
-                        else if (m_Current[d][y * Col + x] &&
-                                neighborAliveCount > 3)
-                        {
-                            m_Next[d][y * Col + x] = false;
-                        }
-                        else if (m_Current[d][y * Col + x] &&
-                                neighborAliveCount > 3)
-                        {
-                            m_Next[d][y * Col + x] = false;
-                        }
-                        else
-                        {
-                            m_Next[d][y * Col + x] = false;
-                        }
-                    }
-                }
+                report(kernel, microseconds);
             }
-
-            std::memcpy(m_Current, m_Next, sizeof(m_Current));
-        }
-
-        const bool* GetCurrent(int d) const noexcept
-        {
-            return m_Current[d];
-        }
-
-        void SetState(int state) noexcept
-        {
-            switch (state)
+            if (fastest == StepKernel::Auto || microseconds < fastestMicroseconds)
             {
-                case 0:
-                    m_State = m_State & 0x1110;
-                    return;
-                case 1:
-                    m_State = m_State | 0x0001;
-                    return;
-                case 2:
-                    m_State = m_State | 0x0010;
-                    return;
-                default:
-                    return;
+                fastest = kernel;
+                fastestMicroseconds = microseconds;
             }
         }
+        return fastest;
+    }
+
+    template <uint32_t Rule, int States>
+    StepKernel BenchmarkStepKernels(const GenerationsImpl<Rule, States>*, GetMicros, IParallel*, ReportStepKernel) noexcept
+    {
+        return StepKernel::Auto;
+    }
 
-    private:
-        void Randomize() noexcept
+    template <uint64_t Rule>
+    StepKernel BenchmarkStepKernels(const LargerThanLifeImpl<Rule>*, GetMicros, IParallel*, ReportStepKernel) noexcept
+    {
+        return StepKernel::Auto;
+    }
+
+    // color (swapped RGB565) scaled by numerator / denominator, never the transparent color
+    uint16_t ScaleColor(uint16_t color, int numerator, int denominator) noexcept
+    {
+        const uint16_t color565 = SwappedColor(color);
+        const int r = ((color565 >> 11) & 0x1F) * numerator / denominator;
+        const int g = ((color565 >>  5) & 0x3F) * numerator / denominator;
+        const int b = ((color565 >>  0) & 0x1F) * numerator / denominator;
+        const uint16_t scaled = SwappedColor(static_cast<uint16_t>((r << 11) | (g << 5) | b));
+        return scaled != ColorTransparent ? scaled : SwappedColor(static_cast<uint16_t>((r << 11) | ((g - 1) << 5) | b));
+    }
+
+    // the state of all cells of a face, -1 when they are not all in the same one
+    int GetUniformState(const StateBitmap& states) noexcept
+    {
+        int state = 0;
+        for (int p = 0; p < states.planeCount; p++)
         {
-            for (int y = 0; y < Row; y++)
+            const Bitmap& plane = states.planes[p];
+            const int words = (plane.width + 31) / 32;
+            const uint32_t lastMask = (plane.width & 31) == 0 ? ~0u : (1u << (plane.width & 31)) - 1;
+            const uint32_t expected = (plane.pRows[0] & 1) != 0 ? ~0u : 0u;
+            for (int y = 0; y < plane.height; y++)
             {
-                for (int x = 0; x < Col; x++)
+                for (int w = 0; w < words; w++)
                 {
-                    for (int d = 0; d < Dimension; d++)
+                    if (((plane.pRows[y * plane.stride + w] ^ expected) & (w == words - 1 ? lastMask : ~0u)) != 0)
                     {
-                        m_Current[d][y * Col + x] = (m_Rnd() % 100) < 10;
+                        return -1;
                     }
                 }
             }
+            state |= static_cast<int>(expected & 1) << p;
         }
-
-        int WrapAround(int value, int max)
-        {
-            return value < 0 ? max - 1 :
-                   value >= max ? 0 : value;
-        }
-
-    private:
-        bool m_Current[Dimension][Row * Col] = {};
-        bool m_Next[Dimension][Row * Col] = {};
-        std::mt19937 m_Rnd;
-        int m_State; // bit1: 0 = Start, 1 = Pause, bit2: Randomize
-    };
-
-    constexpr const int GameOfLifeCol = 32;
-    constexpr const int GameOfLifeRow = 32;
-    typedef GameOfLifeImpl<GameOfLifeCol, GameOfLifeRow> GameOfLife;
-
-    GameOfLife& GetGameOfLife(long seed)
-    {
-        static GameOfLife s_GameOfLife(seed);
-        return s_GameOfLife;
-    }
-
-    GameOfLife& GetGameOfLife()
-    {
-        return GetGameOfLife(0);
+        return state;
     }
 
     inline float InverseSquareRoot(float value) noexcept
@@ -222,89 +261,6 @@ namespace {
         ret.z = Transform(dstAxes, dstVec, srcAxes.z);
         return ret;
     }
-
-    inline void MakeInverse3x3(float matrix[3][3])
-    {
-        // elementary row operations
-        for (int k = 0; k < 3; k++)
-        {
-            float t = matrix[k][k];
-            
-            for (int i = 0; i < 3; i++)
-            {
-                matrix[k][i] /= t;
-            }
-
-            matrix[k][k] = 1 / t;
-
-            for (int j = 0; j < 3; j++)
-            {
-                if (j != k)
-                {
-                    float u = matrix[j][k];
-                    
-                    for (int i = 0; i < 3; i++)
-                    {
-                        if (i != k)
-                        {
-                            matrix[j][i] -= matrix[k][i] * u;
-                        }
-                        else
-                        {
-                            matrix[j][i] = -u / t;
-                        }
-                    }
-                }
-            }
-        }
-    }
-
-    inline void SolveAffineCoefficient(FPosition src[3], FPosition dst[3], float affine[6])
-    {
-        // least squares method
-
-        float rhsx[3] = {};
-        float rhsy[3] = {};
-
-        float matrix[3][3] = {};
-
-        for (int i = 0; i < 3; i++)
-        {
-            auto u = src[i].x;
-            auto v = src[i].y;
-            auto uv = u * v;
-            auto x = dst[i].x;
-            auto y = dst[i].y;
-
-            matrix[0][0] += u * u;
-            matrix[0][1] += uv;
-            matrix[0][2] += u;
-            matrix[1][0] += uv;
-            matrix[1][1] += v * v;
-            matrix[1][2] += v;
-            matrix[2][0] += u;
-            matrix[2][1] += v;
-            matrix[2][2] += 1;
-    
-            rhsx[0] += x * u;
-            rhsx[1] += x * v;
-            rhsx[2] += x;
-
-            rhsy[0] += y * u;
-            rhsy[1] += y * v;
-            rhsy[2] += y;
-        }
-
-        MakeInverse3x3(matrix);
-
-        affine[0] = matrix[0][0] * rhsx[0] + matrix[0][1] * rhsx[1] + matrix[0][2] * rhsx[2];
-        affine[1] = matrix[1][0] * rhsx[0] + matrix[1][1] * rhsx[1] + matrix[1][2] * rhsx[2];
-        affine[2] = matrix[2][0] * rhsx[0] + matrix[2][1] * rhsx[1] + matrix[2][2] * rhsx[2];
-
-        affine[3] = matrix[0][0] * rhsy[0] + matrix[0][1] * rhsy[1] + matrix[0][2] * rhsy[2];
-        affine[4] = matrix[1][0] * rhsy[0] + matrix[1][1] * rhsy[1] + matrix[1][2] * rhsy[2];
-        affine[5] = matrix[2][0] * rhsy[0] + matrix[2][1] * rhsy[1] + matrix[2][2] * rhsy[2];
-    }
 }
 
 namespace {
@@ -322,6 +278,16 @@ namespace {
 
     const Vector3d CameraWorldPosition = { 0.0, 0.0, -3.0 };
 
+    // outward normals of the faces of m_Vertex (see DrawSurface()), the camera looks along +z
+    const Vector3d FaceNormals[GameOfLifeDimension] = {
+        {  0.0,  0.0, -1.0 },
+        {  1.0,  0.0,  0.0 },
+        {  0.0,  0.0,  1.0 },
+        { -1.0,  0.0,  0.0 },
+        {  0.0,  1.0,  0.0 },
+        {  0.0, -1.0,  0.0 }
+    };
+
     Position g_LastMove = {};
 }
 
@@ -351,8 +317,7 @@ namespace detail {
     template <const IconContext& Context>
     void IconBase<Context>::Draw() noexcept
     {
-        std::memcpy(m_Buffer, m_Selected ? Context.pImageForOn : Context.pImageForOff, sizeof(uint16_t) * Context.rect.width * Context.rect.height);
-        m_GetSprite()->PushImageWithAlphaBlend(m_Buffer, Context.rect, m_Position, g_Alpha, g_BgAlpha);
+        m_GetSprite()->PushImageWithAlphaBlend(m_Selected ? Context.pImageForOn : Context.pImageForOff, Context.rect, m_Position, g_Alpha, g_BgAlpha);
     }
 
     constexpr static const uint16_t StartIconOnImage[IconWidth * IconHeight] = {
@@ -382,10 +347,21 @@ namespace detail {
 
 }
 
-    Cube::Cube(GetSprite getSprite, Position position, int length, long seed) noexcept
+    uint32_t GetGenerationCount() noexcept
+    {
+        return g_GenerationCount;
+    }
+
+    StepKernel BenchmarkStepKernels(GetMicros getMicros, IParallel* pParallel, ReportStepKernel report) noexcept
+    {
+        return BenchmarkStepKernels(static_cast<const GameOfLife*>(nullptr), getMicros, pParallel, report);
+    }
+
+    Cube::Cube(GetSprite getSprite, Position position, int length, long seed, Topology topology, GetMicros getMicros, int generationsPerSecond, IParallel* pParallel, StepKernel stepKernel) noexcept
     : m_GetSprite(getSprite)
     , m_Position(position)
     , m_Length(length)
+    , m_Scheduler(getMicros, generationsPerSecond)
     , m_Vertex{
         { -1.0,  1.0, -1.0 },
         {  1.0,  1.0, -1.0 },
@@ -407,12 +383,20 @@ namespace detail {
         { 0.0, 0.0, 0.0 }
     }
     {
-        GetGameOfLife(seed);
+        GetGameOfLife(seed).SetTopology(topology);
+        GetGameOfLife().SetParallel(pParallel);
+        SetCycleCache(GetGameOfLife());
+        SetStepKernel(GetGameOfLife(), stepKernel);
+
+        for (FaceCache& faceCache : m_FaceCaches)
+        {
+            faceCache = { ~0ull, ~0ull, -1 };
+        }
     }
 
     void Cube::Update() noexcept
     {
-        GetGameOfLife().Next();
+        g_GenerationCount += m_Scheduler.Run([]() { return GetGameOfLife().Next(); });
 
         constexpr const float Rate = 0.002;
         constexpr const float nRate = -0.002;
@@ -451,92 +435,44 @@ namespace detail {
     void Cube::Draw() noexcept
     {
         Position vertexPosition[8];
-        float zmax = 0;
-        int zIndex = 0;
         for (int i = 0; i < 8; i++)
         {
             auto vertex = Transform(m_Attitude, m_WorldPosition, m_Vertex[i]);
             vertex = Transform(CameraAttitude, CameraWorldPosition, vertex);
             vertexPosition[i] = NormalizePosition(vertex.x, vertex.y);
-            if (zmax < vertex.z)
+        }
+
+        // The center of a face is its normal, so the z of the turned normal orders the faces from the farthest
+        // to the nearest. Faces turned away from the camera are not drawn unless the cube is see-through.
+        int faces[GameOfLifeDimension];
+        float depths[GameOfLifeDimension];
+        int faceCount = 0;
+        for (int d = 0; d < GameOfLifeDimension; d++)
+        {
+            const auto normal = Transform(CameraAttitude, { 0.0, 0.0, 0.0 }, Transform(m_Attitude, { 0.0, 0.0, 0.0 }, FaceNormals[d]));
+#if !defined(GOL3D_SEE_THROUGH)
+            if (normal.z >= 0.0F)
             {
-                zmax = vertex.z;
-                zIndex = i;
+                continue;
             }
+#endif
+            int i = faceCount++;
+            for (; i > 0 && depths[i - 1] < normal.z; i--)
+            {
+                faces[i] = faces[i - 1];
+                depths[i] = depths[i - 1];
+            }
+            faces[i] = d;
+            depths[i] = normal.z;
         }
 
-        switch (zIndex)
+        for (int i = 0; i < faceCount; i++)
         {
-        case 0:
-            DrawSurface(0, vertexPosition, GetGameOfLife().GetCurrent(0));
-            DrawSurface(3, vertexPosition, GetGameOfLife().GetCurrent(3));
-            DrawSurface(4, vertexPosition, GetGameOfLife().GetCurrent(4));
-            DrawSurface(1, vertexPosition, GetGameOfLife().GetCurrent(1));
-            DrawSurface(2, vertexPosition, GetGameOfLife().GetCurrent(2));
-            DrawSurface(5, vertexPosition, GetGameOfLife().GetCurrent(5));
-            break;
-        case 1:
-            DrawSurface(0, vertexPosition, GetGameOfLife().GetCurrent(0));
-            DrawSurface(1, vertexPosition, GetGameOfLife().GetCurrent(1));
-            DrawSurface(4, vertexPosition, GetGameOfLife().GetCurrent(4));
-            DrawSurface(2, vertexPosition, GetGameOfLife().GetCurrent(2));
-            DrawSurface(3, vertexPosition, GetGameOfLife().GetCurrent(3));
-            DrawSurface(5, vertexPosition, GetGameOfLife().GetCurrent(5));
-            break;
-        case 2:
-            DrawSurface(1, vertexPosition, GetGameOfLife().GetCurrent(1));
-            DrawSurface(2, vertexPosition, GetGameOfLife().GetCurrent(2));
-            DrawSurface(4, vertexPosition, GetGameOfLife().GetCurrent(4));
-            DrawSurface(0, vertexPosition, GetGameOfLife().GetCurrent(0));
-            DrawSurface(3, vertexPosition, GetGameOfLife().GetCurrent(3));
-            DrawSurface(5, vertexPosition, GetGameOfLife().GetCurrent(5));
-            break;
-        case 3:
-            DrawSurface(2, vertexPosition, GetGameOfLife().GetCurrent(2));
-            DrawSurface(3, vertexPosition, GetGameOfLife().GetCurrent(3));
-            DrawSurface(4, vertexPosition, GetGameOfLife().GetCurrent(4));
-            DrawSurface(0, vertexPosition, GetGameOfLife().GetCurrent(0));
-            DrawSurface(1, vertexPosition, GetGameOfLife().GetCurrent(1));
-            DrawSurface(5, vertexPosition, GetGameOfLife().GetCurrent(5));
-            break;
-        case 4:
-            DrawSurface(0, vertexPosition, GetGameOfLife().GetCurrent(0));
-            DrawSurface(3, vertexPosition, GetGameOfLife().GetCurrent(3));
-            DrawSurface(5, vertexPosition, GetGameOfLife().GetCurrent(5));
-            DrawSurface(1, vertexPosition, GetGameOfLife().GetCurrent(1));
-            DrawSurface(2, vertexPosition, GetGameOfLife().GetCurrent(2));
-            DrawSurface(4, vertexPosition, GetGameOfLife().GetCurrent(4));
-            break;
-        case 5:
-            DrawSurface(0, vertexPosition, GetGameOfLife().GetCurrent(0));
-            DrawSurface(1, vertexPosition, GetGameOfLife().GetCurrent(1));
-            DrawSurface(5, vertexPosition, GetGameOfLife().GetCurrent(5));
-            DrawSurface(2, vertexPosition, GetGameOfLife().GetCurrent(2));
-            DrawSurface(3, vertexPosition, GetGameOfLife().GetCurrent(3));
-            DrawSurface(4, vertexPosition, GetGameOfLife().GetCurrent(4));
-            break;
-        case 6:
-            DrawSurface(1, vertexPosition, GetGameOfLife().GetCurrent(1));
-            DrawSurface(2, vertexPosition, GetGameOfLife().GetCurrent(2));
-            DrawSurface(5, vertexPosition, GetGameOfLife().GetCurrent(5));
-            DrawSurface(0, vertexPosition, GetGameOfLife().GetCurrent(0));
-            DrawSurface(3, vertexPosition, GetGameOfLife().GetCurrent(3));
-            DrawSurface(4, vertexPosition, GetGameOfLife().GetCurrent(4));
-            break;
-        case 7:
-            DrawSurface(2, vertexPosition, GetGameOfLife().GetCurrent(2));
-            DrawSurface(3, vertexPosition, GetGameOfLife().GetCurrent(3));
-            DrawSurface(5, vertexPosition, GetGameOfLife().GetCurrent(5));
-            DrawSurface(0, vertexPosition, GetGameOfLife().GetCurrent(0));
-            DrawSurface(1, vertexPosition, GetGameOfLife().GetCurrent(1));
-            DrawSurface(4, vertexPosition, GetGameOfLife().GetCurrent(4));
-            break;
-        default:
-            break;
+            DrawSurface(faces[i], vertexPosition, GetStates(GetGameOfLife(), faces[i]));
         }
     }
 
-    inline void Cube::DrawSurface(int surfaceIndex, const Position* pVertexPosition, const bool* pGameOfLifeBitmap) noexcept
+    inline void Cube::DrawSurface(int surfaceIndex, const Position* pVertexPosition, const StateBitmap& gameOfLifeStates) noexcept
     {
         int _vertex[3] = {};
         uint16_t _color = 0;
@@ -583,27 +519,44 @@ namespace detail {
             break;
         }
 
-        FPosition _src[3] = { { 0.0, 0.0 }, { static_cast<float>(BufferWidth), 0.0 }, { 0.0, static_cast<float>(BufferHeight) } };
-        FPosition _dst[3] = { 
+        const FPosition _dst[3] = {
             { static_cast<float>(pVertexPosition[_vertex[0]].x), static_cast<float>(pVertexPosition[_vertex[0]].y) },
             { static_cast<float>(pVertexPosition[_vertex[1]].x), static_cast<float>(pVertexPosition[_vertex[1]].y) },
             { static_cast<float>(pVertexPosition[_vertex[2]].x), static_cast<float>(pVertexPosition[_vertex[2]].y) },
         };
 
-        float _affine[6] = {};
-        SolveAffineCoefficient(_src, _dst, _affine);
+        // alive cells in the color of the face, decaying ones fading to black
+        uint16_t _ramp[16] = { ColorBlack, _color };
+        for (int s = 2; s < gameOfLifeStates.states; s++)
+        {
+            _ramp[s] = ScaleColor(_color, gameOfLifeStates.states - s, gameOfLifeStates.states - 1);
+        }
 
-        for (int y = 0; y < BufferHeight; y++)
+        // Faces whose cells are all in one state (most of them once a soup has settled) are filled without
+        // looking at the cells. A face is looked at again on a new revision, and on a new generation unless it
+        // follows the cached one and the engine counted no change of the face in between (GameOfLifeImpl, see
+        // IsFaceUnchanged()). A paused cube or a settled face is not looked at again.
+        FaceCache& _cache = m_FaceCaches[surfaceIndex];
+        const uint64_t _generation = GetGameOfLife().GetGeneration();
+        const uint64_t _revision = GetGameOfLife().GetRevision();
+        const bool _unchanged = _cache.revision == _revision &&
+                                (_cache.generation == _generation ||
+                                 (_cache.generation + 1 == _generation && IsFaceUnchanged(GetGameOfLife(), surfaceIndex)));
+        if (!_unchanged)
         {
-            for (int x = 0; x < BufferWidth; x++)
-            {
-                int sy = y >> 1; // / (BufferHeight / GameOfLifeCol)
-                int sx = x >> 1; // / (BufferWidth / GameOfLifeRow)
-                m_Buffer[y * BufferWidth + x] = pGameOfLifeBitmap[sy * GameOfLifeRow + sx] ? _color : ColorBlack;
-            }
+            _cache.uniformState = GetUniformState(gameOfLifeStates);
         }
+        _cache.generation = _generation;
+        _cache.revision = _revision;
 
-        m_GetSprite()->PushImageAffineWithAlphaBlend(m_Buffer, { BufferWidth, BufferHeight }, _affine, g_Alpha, g_BgAlpha);
+        if (_cache.uniformState >= 0)
+        {
+            m_GetSprite()->FillWithAlphaBlend(_dst, _ramp[_cache.uniformState], g_Alpha, g_BgAlpha);
+        }
+        else
+        {
+            m_GetSprite()->DrawCellsWithAlphaBlend(gameOfLifeStates, _ramp, _dst, g_Alpha, g_BgAlpha);
+        }
     }
 
     inline Position Cube::NormalizePosition(float x, float y) const noexcept
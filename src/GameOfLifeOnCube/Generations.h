@@ -0,0 +1,426 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "Type.h"
+#include "GameOfLife.h"
+#include "StepKernel.h"
+#include "Parallel.h"
+#include "Random.h"
+
+namespace Gol3d {
+
+    // Generations rules ("S/B/C" in Golly), B and S count the neighbors in state 1 only.
+    constexpr const uint32_t BriansBrainRule = ParseRule("B2/S");    // C = 3
+    constexpr const uint32_t StarWarsRule = ParseRule("B2/S345");    // C = 4
+
+    // Six faces of Col x Row cells of States states. A cell in state 1 is alive, it stays so as the rule
+    // says and decays otherwise: 1 -> 2 -> ... -> States - 1 -> 0. Only dead cells are born.
+    //
+    // The state of a cell is held in Planes bit planes (bit p of the state in plane p), so that a word of
+    // every plane steps 32 cells with the same bitwise arithmetic as GameOfLifeImpl. The alive cells are
+    // also kept in the padded layout of GameOfLifeImpl (halo rows and pad words), which detail::NextWord counts on.
+    // All storage comes from the arena handed to the constructor.
+    template <uint32_t Rule, int States>
+    class GenerationsImpl
+    {
+        static_assert(States >= 2 && States <= 16, "2 .. 16 states");
+
+    public:
+        static const int Dimension = GameOfLifeDimension;
+        static const int Planes = States <= 2 ? 1 : States <= 4 ? 2 : States <= 8 ? 3 : 4;
+
+        // Bytes of arena needed for faces of col x row cells.
+        static constexpr size_t GetArenaSize(int col, int row) noexcept
+        {
+            return sizeof(uint32_t) * Dimension * (Planes * row * detail::GetWordCount(col) + GetAliveWordCount(col, row));
+        }
+
+        // pArena must hold GetArenaSize(col, row) bytes aligned for uint32_t, and outlive the instance.
+        GenerationsImpl(int col, int row, void* pArena, long seed) noexcept
+        : m_Col(col)
+        , m_Row(row)
+        , m_Words(detail::GetWordCount(col))
+        , m_Stride(detail::GetWordCount(col) + 1)
+        , m_AliveWords(GetAliveWordCount(col, row))
+        , m_LastMask((col & 31) == 0 ? ~0u : (1u << (col & 31)) - 1)
+        , m_Rnd(seed)
+        {
+            std::memset(pArena, 0, GetArenaSize(col, row));
+            uint32_t* p = static_cast<uint32_t*>(pArena);
+            m_pPlanes = p;
+            p += Dimension * Planes * row * m_Words;
+            m_pAlive = p;
+
+            Randomize();
+        }
+
+        // Returns false when no generation was stepped: randomized or paused.
+        bool Next() noexcept
+        {
+            if ((m_State & 0x0010) == 0x0010)
+            {
+                Randomize();
+                m_State = (m_State & 0x0001);
+                return false;
+            }
+            else if ((m_State & 0x0001) == 0x0001)
+            {
+                return false;
+            }
+
+            ExchangeHalo();
+
+            // a face only writes its own planes, the alive cells are read only until all are stepped
+            if (m_pParallel != nullptr)
+            {
+                m_pParallel->For(Dimension, StepTask, this);
+            }
+            else
+            {
+                for (int d = 0; d < Dimension; d++)
+                {
+                    StepFace(d);
+                }
+            }
+
+            for (int d = 0; d < Dimension; d++)
+            {
+                UpdateAlive(d);
+            }
+            m_Generation++;
+            return true;
+        }
+
+        // the alive cells (state 1)
+        Bitmap GetCurrent(int d) const noexcept
+        {
+            return { GetAlive(d) + GetRowOffset(1), m_Stride, m_Col, m_Row };
+        }
+
+        StateBitmap GetStates(int d) const noexcept
+        {
+            StateBitmap states = {};
+            for (int p = 0; p < Planes; p++)
+            {
+                states.planes[p] = { GetPlane(d, p), m_Words, m_Col, m_Row };
+            }
+            states.planeCount = Planes;
+            states.states = States;
+            return states;
+        }
+
+        // generations stepped since the start
+        uint64_t GetGeneration() const noexcept
+        {
+            return m_Generation;
+        }
+
+        // Counts the changes of the cells that are no generation (Randomize()), see GameOfLifeImpl::GetRevision().
+        uint64_t GetRevision() const noexcept
+        {
+            return m_Revision;
+        }
+
+        int GetCol() const noexcept
+        {
+            return m_Col;
+        }
+
+        int GetRow() const noexcept
+        {
+            return m_Row;
+        }
+
+        void SetState(int state) noexcept
+        {
+            switch (state)
+            {
+                case 0:
+                    m_State = m_State & 0x1110;
+                    return;
+                case 1:
+                    m_State = m_State | 0x0001;
+                    return;
+                case 2:
+                    m_State = m_State | 0x0010;
+                    return;
+                default:
+                    return;
+            }
+        }
+
+        // The chance of a cell to start alive on Randomize(), in 1 / 65536 (see DensityFromPercent()).
+        void SetDensity(uint32_t density) noexcept
+        {
+            m_Density = density;
+        }
+
+        // The same seed and density give the same cells on the next Randomize().
+        void SetSeed(long seed) noexcept
+        {
+            m_Rnd.Seed(seed);
+        }
+
+        // Spreads Next() over the cores a face at a time, nullptr steps on the calling thread only.
+        void SetParallel(IParallel* pParallel) noexcept
+        {
+            m_pParallel = pParallel;
+        }
+
+        // The stitched topology needs square faces, it is ignored otherwise.
+        void SetTopology(Topology topology) noexcept
+        {
+            if (topology == Topology::Stitched && m_Col != m_Row)
+            {
+                return;
+            }
+            m_Topology = topology;
+        }
+
+    private:
+        static constexpr int GetAliveWordCount(int col, int row) noexcept
+        {
+            return 1 + (row + 2) * (detail::GetWordCount(col) + 1);
+        }
+
+        uint32_t* GetPlane(int d, int p) const noexcept
+        {
+            return m_pPlanes + (d * Planes + p) * m_Row * m_Words;
+        }
+
+        uint32_t* GetAlive(int d) const noexcept
+        {
+            return m_pAlive + d * m_AliveWords;
+        }
+
+        // the first word of the padded row r, its pad word is the one before
+        int GetRowOffset(int r) const noexcept
+        {
+            return 1 + r * m_Stride;
+        }
+
+        void Randomize() noexcept
+        {
+            std::memset(m_pPlanes, 0, sizeof(uint32_t) * Dimension * Planes * m_Row * m_Words);
+            for (int d = 0; d < Dimension; d++)
+            {
+                uint32_t* pAlive = GetPlane(d, 0);
+                for (int y = 0; y < m_Row; y++)
+                {
+                    for (int w = 0; w < m_Words; w++)
+                    {
+                        pAlive[y * m_Words + w] = detail::RandomWord(m_Rnd, m_Density);
+                    }
+                    pAlive[y * m_Words + m_Words - 1] &= m_LastMask;
+                }
+            }
+
+            for (int d = 0; d < Dimension; d++)
+            {
+                UpdateAlive(d);
+            }
+            m_Revision++;
+        }
+
+        // The alive cells of the face d from its planes, the halo is left to ExchangeHalo().
+        void UpdateAlive(int d) noexcept
+        {
+            uint32_t* pAlive = GetAlive(d);
+            for (int y = 0; y < m_Row; y++)
+            {
+                for (int w = 0; w < m_Words; w++)
+                {
+                    uint32_t alive = GetPlane(d, 0)[y * m_Words + w];
+                    for (int p = 1; p < Planes; p++)
+                    {
+                        alive &= ~GetPlane(d, p)[y * m_Words + w];
+                    }
+                    pAlive[GetRowOffset(y + 1) + w] = alive;
+                }
+            }
+        }
+
+        bool GetAliveCell(int d, int x, int y) const noexcept
+        {
+            return ((GetAlive(d)[GetRowOffset(y + 1) + (x >> 5)] >> (x & 31)) & 1) != 0;
+        }
+
+        // the alive cell (x, y) of the face d, which may lie a cell beyond an edge (see detail::LocateCell())
+        bool GetHaloCell(int d, int x, int y) const noexcept
+        {
+            return detail::LocateCell(m_Topology, m_Col, m_Row, d, x, y) && GetAliveCell(d, x, y);
+        }
+
+        // sets the cell (x, r) of the padded face, x being -1 or Col for the halo columns
+        void SetHaloCell(uint32_t* pAlive, int x, int r) const noexcept
+        {
+            if (x < 0)
+            {
+                pAlive[r * m_Stride] |= 1u << 31;
+            }
+            else if (x < m_Col)
+            {
+                pAlive[GetRowOffset(r) + (x >> 5)] |= 1u << (x & 31);
+            }
+            else if ((m_Col & 31) == 0)
+            {
+                pAlive[(r + 1) * m_Stride] |= 1;
+            }
+            else
+            {
+                pAlive[GetRowOffset(r) + m_Words - 1] |= 1u << (m_Col & 31);
+            }
+        }
+
+        // The halo cells around the alive cells of every face, cell by cell: the rules of this family
+        // keep so many cells busy that the border is nothing next to the stepping.
+        void ExchangeHalo() noexcept
+        {
+            for (int d = 0; d < Dimension; d++)
+            {
+                uint32_t* pAlive = GetAlive(d);
+                std::memset(pAlive + GetRowOffset(0), 0, sizeof(uint32_t) * m_Words);
+                std::memset(pAlive + GetRowOffset(m_Row + 1), 0, sizeof(uint32_t) * m_Words);
+                for (int r = 0; r < m_Row + 3; r++)
+                {
+                    pAlive[r * m_Stride] = 0;
+                }
+                for (int r = 1; r <= m_Row; r++)
+                {
+                    pAlive[GetRowOffset(r) + m_Words - 1] &= m_LastMask;
+                }
+
+                for (int x = 0; x < m_Col; x++)
+                {
+                    if (GetHaloCell(d, x, -1))
+                    {
+                        SetHaloCell(pAlive, x, 0);
+                    }
+                    if (GetHaloCell(d, x, m_Row))
+                    {
+                        SetHaloCell(pAlive, x, m_Row + 1);
+                    }
+                }
+                for (int y = 0; y < m_Row; y++)
+                {
+                    if (GetHaloCell(d, -1, y))
+                    {
+                        SetHaloCell(pAlive, -1, y + 1);
+                    }
+                    if (GetHaloCell(d, m_Col, y))
+                    {
+                        SetHaloCell(pAlive, m_Col, y + 1);
+                    }
+                }
+
+                // three faces meet at a cube corner, so the corners stay dead unless the face is a torus
+                if (m_Topology == Topology::Torus)
+                {
+                    const bool corners[4] = {
+                        GetHaloCell(d, -1, -1), GetHaloCell(d, -1, m_Row), GetHaloCell(d, m_Col, -1), GetHaloCell(d, m_Col, m_Row),
+                    };
+                    if (corners[0])
+                    {
+                        SetHaloCell(pAlive, -1, 0);
+                    }
+                    if (corners[1])
+                    {
+                        SetHaloCell(pAlive, -1, m_Row + 1);
+                    }
+                    if (corners[2])
+                    {
+                        SetHaloCell(pAlive, m_Col, 0);
+                    }
+                    if (corners[3])
+                    {
+                        SetHaloCell(pAlive, m_Col, m_Row + 1);
+                    }
+                }
+            }
+        }
+
+        static void StepTask(void* pContext, int index) noexcept
+        {
+            static_cast<GenerationsImpl*>(pContext)->StepFace(index);
+        }
+
+        void StepFace(int d) noexcept
+        {
+            const uint32_t* pAlive = GetAlive(d);
+            uint32_t* pPlanes[Planes];
+            for (int p = 0; p < Planes; p++)
+            {
+                pPlanes[p] = GetPlane(d, p);
+            }
+
+            for (int y = 0; y < m_Row; y++)
+            {
+                for (int w = 0; w < m_Words; w++)
+                {
+                    const int i = y * m_Words + w;
+                    const uint32_t* pWord = pAlive + GetRowOffset(y + 1) + w;
+                    uint32_t state[Planes];
+                    uint32_t busy = 0;
+                    for (int p = 0; p < Planes; p++)
+                    {
+                        state[p] = pPlanes[p][i];
+                        busy |= state[p];
+                    }
+
+                    // born from dead cells or surviving alive ones, decaying cells do not count
+                    const uint32_t alive = detail::NextWord<Rule, uint32_t>(pWord - m_Stride, pWord, pWord + m_Stride) & (*pWord | ~busy);
+
+                    // every other cell that is not dead goes one state on, States wraps to 0
+                    uint32_t carry = busy;
+                    for (int p = 0; p < Planes; p++)
+                    {
+                        const uint32_t t = state[p];
+                        state[p] ^= carry;
+                        carry &= t;
+                    }
+                    if ((States & (States - 1)) != 0)
+                    {
+                        uint32_t wrapped = ~0u;
+                        for (int p = 0; p < Planes; p++)
+                        {
+                            wrapped &= ((States >> p) & 1) ? state[p] : ~state[p];
+                        }
+                        for (int p = 0; p < Planes; p++)
+                        {
+                            state[p] &= ~wrapped;
+                        }
+                    }
+
+                    const uint32_t mask = w == m_Words - 1 ? m_LastMask : ~0u;
+                    pPlanes[0][i] = (state[0] | alive) & mask;
+                    for (int p = 1; p < Planes; p++)
+                    {
+                        pPlanes[p][i] = state[p] & ~alive & mask;
+                    }
+                }
+            }
+        }
+
+        int m_Col;
+        int m_Row;
+        int m_Words;
+        int m_Stride;
+        int m_AliveWords;
+        uint32_t m_LastMask;
+        // Planes planes of Row x m_Words words per face
+        uint32_t* m_pPlanes;
+        // the alive cells of every face in the padded layout of GameOfLifeImpl
+        uint32_t* m_pAlive;
+        IParallel* m_pParallel = nullptr;
+
+        detail::Xoshiro128 m_Rnd;
+        uint32_t m_Density = DefaultDensity;
+        int m_State = 0; // bit1: 0 = Start, 1 = Pause, bit2: Randomize
+        uint64_t m_Generation = 0;
+        uint64_t m_Revision = 0;
+        Topology m_Topology = Topology::Torus;
+    };
+
+}
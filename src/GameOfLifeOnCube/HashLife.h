@@ -0,0 +1,542 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "Type.h"
+#include "GameOfLife.h"
+#include "StepKernel.h"
+
+namespace Gol3d {
+
+    // Fast-forwards the six faces by 2^k generations at once with a memoized quadtree (HashLife).
+    // Every face is a torus of Length x Length cells (a power of two, MinLength .. MaxLength),
+    // and is tiled over the plane so that the quadtree never sees the wrap.
+    //
+    // Nodes are hash-consed in a pool of fixed capacity carved from the arena. A jump that runs
+    // out of nodes collects the garbage (everything not reachable from the faces) and retries once.
+    template <uint32_t Rule>
+    class HashLifeImpl
+    {
+        static_assert((Rule & 1) == 0, "an empty region has to stay empty");
+
+    public:
+        static const int Dimension = GameOfLifeDimension;
+        static const int MinLength = 16;
+        static const int MaxLength = 4096;
+
+        static constexpr bool IsSupportedLength(int length) noexcept
+        {
+            return length >= MinLength && length <= MaxLength && (length & (length - 1)) == 0;
+        }
+
+        // Bytes of arena needed for faces of length x length cells and a pool of nodeCapacity nodes.
+        static constexpr size_t GetArenaSize(int length, int nodeCapacity) noexcept
+        {
+            return sizeof(Node) * nodeCapacity +
+                   sizeof(uint32_t) * GetBucketCount(nodeCapacity) +
+                   sizeof(uint32_t) * Dimension * length * detail::GetWordCount(length);
+        }
+
+        // pArena must hold GetArenaSize(length, nodeCapacity) bytes aligned for uint32_t, and outlive the instance.
+        // The faces start empty.
+        HashLifeImpl(int length, int nodeCapacity, void* pArena) noexcept
+        : m_Length(length)
+        , m_Level(GetLevel(length))
+        , m_Words(detail::GetWordCount(length))
+        , m_Capacity(nodeCapacity)
+        , m_BucketMask(GetBucketCount(nodeCapacity) - 1)
+        {
+            std::memset(pArena, 0, GetArenaSize(length, nodeCapacity));
+            uint8_t* p = static_cast<uint8_t*>(pArena);
+            m_pNodes = reinterpret_cast<Node*>(p);
+            p += sizeof(Node) * nodeCapacity;
+            m_pBuckets = reinterpret_cast<uint32_t*>(p);
+            p += sizeof(uint32_t) * GetBucketCount(nodeCapacity);
+            m_pCells = reinterpret_cast<uint32_t*>(p);
+
+            for (int d = 0; d < Dimension; d++)
+            {
+                m_Root[d] = Build(GetCurrent(d), 0, 0, m_Level);
+            }
+        }
+
+        // bitmap has to be Length x Length, GameOfLifeImpl::GetCurrent() of a torus fits as is
+        void SetCurrent(int d, const Bitmap& bitmap) noexcept
+        {
+            const uint32_t root = Build(bitmap, 0, 0, m_Level);
+            if (root == 0)
+            {
+                Collect();
+                m_Root[d] = Build(bitmap, 0, 0, m_Level);
+            }
+            else
+            {
+                m_Root[d] = root;
+            }
+            WriteFace(d);
+        }
+
+        Bitmap GetCurrent(int d) const noexcept
+        {
+            return { m_pCells + d * m_Length * m_Words, m_Words, m_Length, m_Length };
+        }
+
+        // Advances every face by 2^k generations (0 <= k <= 60).
+        // Returns false, leaving the faces as they were, when the node pool is too small for the jump.
+        bool Jump(int k) noexcept
+        {
+            if (m_Count > m_Capacity - m_Capacity / 4)
+            {
+                Collect();
+            }
+            if (!Advance(k))
+            {
+                Collect();
+                if (!Advance(k))
+                {
+                    return false;
+                }
+            }
+            for (int d = 0; d < Dimension; d++)
+            {
+                WriteFace(d);
+            }
+            m_Generation += static_cast<uint64_t>(1) << k;
+            return true;
+        }
+
+        // one generation, as Jump(0)
+        bool Next() noexcept
+        {
+            return Jump(0);
+        }
+
+        // generations jumped since the start
+        uint64_t GetGeneration() const noexcept
+        {
+            return m_Generation;
+        }
+
+        int GetCol() const noexcept
+        {
+            return m_Length;
+        }
+
+        int GetRow() const noexcept
+        {
+            return m_Length;
+        }
+
+        // nodes in use, including memoized results not collected yet
+        int GetNodeCount() const noexcept
+        {
+            return m_Count;
+        }
+
+    private:
+        // A node of level l is a square of 2^l cells. Level 3 nodes are leaves holding 8 x 8 cells,
+        // bit 8 * y + x being the cell (x, y). Index 0 is no node, it is returned when the pool is full.
+        struct Node
+        {
+            uint32_t child[4]; // nw, ne, sw, se; the cells of a leaf in child[0] and child[1]
+            uint32_t result;   // the center half of the node 2^min(m_Step, level - 2) generations later
+            uint32_t next;     // the next node in the bucket, or in the free list
+            uint8_t level;
+            bool marked;
+        };
+
+        static const int LeafLevel = 3;
+        static const uint8_t FreeLevel = 0xFF;
+
+        static constexpr int GetBucketCount(int capacity, int count = 1) noexcept
+        {
+            return count >= capacity ? count : GetBucketCount(capacity, count * 2);
+        }
+
+        static constexpr int GetLevel(int length, int level = 0) noexcept
+        {
+            return (1 << level) >= length ? level : GetLevel(length, level + 1);
+        }
+
+        static uint32_t Hash(uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t level) noexcept
+        {
+            uint32_t h = level * 0x9E3779B9u;
+            h = (h ^ a) * 0x85EBCA6Bu;
+            h = (h ^ b) * 0xC2B2AE35u;
+            h = (h ^ c) * 0x27D4EB2Fu;
+            h = (h ^ d) * 0x165667B1u;
+            return h ^ (h >> 15);
+        }
+
+        // the one node with these children (cells for a leaf), 0 when the pool is full
+        uint32_t Find(uint32_t a, uint32_t b, uint32_t c, uint32_t d, int level) noexcept
+        {
+            uint32_t& bucket = m_pBuckets[Hash(a, b, c, d, level) & m_BucketMask];
+            for (uint32_t n = bucket; n != 0; n = m_pNodes[n].next)
+            {
+                const Node& node = m_pNodes[n];
+                if (node.level == level && node.child[0] == a && node.child[1] == b && node.child[2] == c && node.child[3] == d)
+                {
+                    return n;
+                }
+            }
+
+            uint32_t n = m_FreeList;
+            if (n != 0)
+            {
+                m_FreeList = m_pNodes[n].next;
+            }
+            else if (m_Top < m_Capacity)
+            {
+                n = m_Top++;
+            }
+            else
+            {
+                return 0;
+            }
+
+            Node& node = m_pNodes[n];
+            node.child[0] = a;
+            node.child[1] = b;
+            node.child[2] = c;
+            node.child[3] = d;
+            node.result = 0;
+            node.next = bucket;
+            node.level = static_cast<uint8_t>(level);
+            node.marked = false;
+            bucket = n;
+            m_Count++;
+            return n;
+        }
+
+        uint32_t Leaf(uint64_t cells) noexcept
+        {
+            return Find(static_cast<uint32_t>(cells), static_cast<uint32_t>(cells >> 32), 0, 0, LeafLevel);
+        }
+
+        uint32_t Join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) noexcept
+        {
+            if (nw == 0 || ne == 0 || sw == 0 || se == 0)
+            {
+                return 0;
+            }
+            return Find(nw, ne, sw, se, m_pNodes[nw].level + 1);
+        }
+
+        uint32_t GetChild(uint32_t n, int quadrant) const noexcept
+        {
+            return n == 0 ? 0 : m_pNodes[n].child[quadrant];
+        }
+
+        uint64_t GetCells(uint32_t n) const noexcept
+        {
+            return m_pNodes[n].child[0] | (static_cast<uint64_t>(m_pNodes[n].child[1]) << 32);
+        }
+
+        // the center half of a node of level 4 or more
+        uint32_t Center(uint32_t n) noexcept
+        {
+            const Node& node = m_pNodes[n];
+            if (node.level > LeafLevel + 1)
+            {
+                return Join(GetChild(node.child[0], 3), GetChild(node.child[1], 2), GetChild(node.child[2], 1), GetChild(node.child[3], 0));
+            }
+
+            const uint64_t nw = GetCells(node.child[0]);
+            const uint64_t ne = GetCells(node.child[1]);
+            const uint64_t sw = GetCells(node.child[2]);
+            const uint64_t se = GetCells(node.child[3]);
+            uint64_t cells = 0;
+            for (int y = 0; y < 4; y++)
+            {
+                const uint64_t upper = ((nw >> (8 * (y + 4) + 4)) & 0x0F) | (((ne >> (8 * (y + 4))) & 0x0F) << 4);
+                const uint64_t lower = ((sw >> (8 * y + 4)) & 0x0F) | (((se >> (8 * y)) & 0x0F) << 4);
+                cells |= (upper << (8 * y)) | (lower << (8 * (y + 4)));
+            }
+            return Leaf(cells);
+        }
+
+        // The center half of the node 2^min(m_Step, level - 2) generations later, memoized in the node.
+        uint32_t Result(uint32_t n) noexcept
+        {
+            if (m_pNodes[n].result != 0)
+            {
+                return m_pNodes[n].result;
+            }
+
+            const int level = m_pNodes[n].level;
+            uint32_t result;
+            if (level == LeafLevel + 1)
+            {
+                result = LeafResult(n);
+            }
+            else
+            {
+                const uint32_t nw = m_pNodes[n].child[0];
+                const uint32_t ne = m_pNodes[n].child[1];
+                const uint32_t sw = m_pNodes[n].child[2];
+                const uint32_t se = m_pNodes[n].child[3];
+
+                // the nine overlapping squares of half the size
+                uint32_t squares[9] = {
+                    nw, Join(GetChild(nw, 1), GetChild(ne, 0), GetChild(nw, 3), GetChild(ne, 2)), ne,
+                    Join(GetChild(nw, 2), GetChild(nw, 3), GetChild(sw, 0), GetChild(sw, 1)),
+                    Join(GetChild(nw, 3), GetChild(ne, 2), GetChild(sw, 1), GetChild(se, 0)),
+                    Join(GetChild(ne, 2), GetChild(ne, 3), GetChild(se, 0), GetChild(se, 1)),
+                    sw, Join(GetChild(sw, 1), GetChild(se, 0), GetChild(sw, 3), GetChild(se, 2)), se,
+                };
+
+                // At full speed both halves of the way are results, otherwise the first half only crops.
+                const bool fullSpeed = m_Step >= level - 2;
+                for (int i = 0; i < 9; i++)
+                {
+                    squares[i] = squares[i] == 0 ? 0 : fullSpeed ? Result(squares[i]) : Center(squares[i]);
+                    if (squares[i] == 0)
+                    {
+                        return 0;
+                    }
+                }
+
+                const uint32_t a = Join(squares[0], squares[1], squares[3], squares[4]);
+                const uint32_t b = Join(squares[1], squares[2], squares[4], squares[5]);
+                const uint32_t c = Join(squares[3], squares[4], squares[6], squares[7]);
+                const uint32_t d = Join(squares[4], squares[5], squares[7], squares[8]);
+                if (a == 0 || b == 0 || c == 0 || d == 0)
+                {
+                    return 0;
+                }
+                const uint32_t ra = Result(a);
+                const uint32_t rb = ra == 0 ? 0 : Result(b);
+                const uint32_t rc = rb == 0 ? 0 : Result(c);
+                const uint32_t rd = rc == 0 ? 0 : Result(d);
+                result = Join(ra, rb, rc, rd);
+            }
+
+            if (result != 0)
+            {
+                m_pNodes[n].result = result;
+            }
+            return result;
+        }
+
+        // Steps the 16 x 16 cells of a level 4 node with the bit-parallel kernel, up to 4 generations
+        // keep the center 8 x 8 exact without knowing anything around.
+        uint32_t LeafResult(uint32_t n) noexcept
+        {
+            const Node& node = m_pNodes[n];
+            uint32_t rows[16];
+            for (int y = 0; y < 8; y++)
+            {
+                rows[y] = ((GetCells(node.child[0]) >> (8 * y)) & 0xFF) | (((GetCells(node.child[1]) >> (8 * y)) & 0xFF) << 8);
+                rows[y + 8] = ((GetCells(node.child[2]) >> (8 * y)) & 0xFF) | (((GetCells(node.child[3]) >> (8 * y)) & 0xFF) << 8);
+            }
+
+            const int generations = 1 << (m_Step < 2 ? m_Step : 2);
+            for (int g = 0; g < generations; g++)
+            {
+                uint32_t next[16];
+                for (int y = 0; y < 16; y++)
+                {
+                    const uint32_t above = y > 0 ? rows[y - 1] : 0;
+                    const uint32_t below = y < 15 ? rows[y + 1] : 0;
+                    uint32_t aboveSum, aboveCarry, belowSum, belowCarry, rowSum, rowCarry;
+                    detail::FullAdd(above << 1, above, above >> 1, aboveSum, aboveCarry);
+                    detail::FullAdd(below << 1, below, below >> 1, belowSum, belowCarry);
+                    detail::HalfAdd(rows[y] << 1, rows[y] >> 1, rowSum, rowCarry);
+
+                    uint32_t s0, c0, t, c1, s1, c2, s2, s3;
+                    detail::FullAdd(aboveSum, belowSum, rowSum, s0, c0);
+                    detail::FullAdd(aboveCarry, belowCarry, rowCarry, t, c1);
+                    detail::HalfAdd(t, c0, s1, c2);
+                    detail::HalfAdd(c1, c2, s2, s3);
+                    next[y] = detail::RuleKernel<Rule, uint32_t>::Apply(rows[y], s0, s1, s2, s3) & 0xFFFF;
+                }
+                std::memcpy(rows, next, sizeof(rows));
+            }
+
+            uint64_t cells = 0;
+            for (int y = 0; y < 8; y++)
+            {
+                cells |= static_cast<uint64_t>((rows[y + 4] >> 4) & 0xFF) << (8 * y);
+            }
+            return Leaf(cells);
+        }
+
+        // Tiles every face over a square big enough for the jump and keeps what is left of it
+        // 2^k generations later. The faces only change when all of them made it.
+        bool Advance(int k) noexcept
+        {
+            if (k != m_Step)
+            {
+                m_Step = k;
+                for (int n = 1; n < m_Top; n++)
+                {
+                    m_pNodes[n].result = 0;
+                }
+            }
+
+            const int level = k + 2 > m_Level + 1 ? k + 2 : m_Level + 1;
+            uint32_t roots[Dimension];
+            for (int d = 0; d < Dimension; d++)
+            {
+                uint32_t n = m_Root[d];
+                for (int l = m_Level; l < level; l++)
+                {
+                    n = Join(n, n, n, n);
+                }
+                n = n == 0 ? 0 : Result(n);
+                if (n == 0)
+                {
+                    return false;
+                }
+
+                // The result starts 2^(level - 2) cells into the tiling. Below one face length that is
+                // half a face, so the quadrants swap places, otherwise the face is its top left corner.
+                if (level == m_Level + 1)
+                {
+                    n = Join(GetChild(n, 3), GetChild(n, 2), GetChild(n, 1), GetChild(n, 0));
+                }
+                else
+                {
+                    for (int l = level - 1; l > m_Level; l--)
+                    {
+                        n = GetChild(n, 0);
+                    }
+                }
+                if (n == 0)
+                {
+                    return false;
+                }
+                roots[d] = n;
+            }
+
+            std::memcpy(m_Root, roots, sizeof(m_Root));
+            return true;
+        }
+
+        uint32_t Build(const Bitmap& bitmap, int x, int y, int level) noexcept
+        {
+            if (level == LeafLevel)
+            {
+                uint64_t cells = 0;
+                for (int r = 0; r < 8; r++)
+                {
+                    const uint32_t row = bitmap.pRows[(y + r) * bitmap.stride + (x >> 5)] >> (x & 31);
+                    cells |= static_cast<uint64_t>(row & 0xFF) << (8 * r);
+                }
+                return Leaf(cells);
+            }
+
+            const int half = 1 << (level - 1);
+            const uint32_t nw = Build(bitmap, x, y, level - 1);
+            const uint32_t ne = nw == 0 ? 0 : Build(bitmap, x + half, y, level - 1);
+            const uint32_t sw = ne == 0 ? 0 : Build(bitmap, x, y + half, level - 1);
+            const uint32_t se = sw == 0 ? 0 : Build(bitmap, x + half, y + half, level - 1);
+            return Join(nw, ne, sw, se);
+        }
+
+        void WriteFace(int d) noexcept
+        {
+            uint32_t* pCells = m_pCells + d * m_Length * m_Words;
+            std::memset(pCells, 0, sizeof(uint32_t) * m_Length * m_Words);
+            Write(m_Root[d], 0, 0, pCells);
+        }
+
+        void Write(uint32_t n, int x, int y, uint32_t* pCells) const noexcept
+        {
+            const Node& node = m_pNodes[n];
+            if (node.level == LeafLevel)
+            {
+                const uint64_t cells = GetCells(n);
+                for (int r = 0; r < 8; r++)
+                {
+                    pCells[(y + r) * m_Words + (x >> 5)] |= static_cast<uint32_t>((cells >> (8 * r)) & 0xFF) << (x & 31);
+                }
+                return;
+            }
+
+            const int half = 1 << (node.level - 1);
+            Write(node.child[0], x, y, pCells);
+            Write(node.child[1], x + half, y, pCells);
+            Write(node.child[2], x, y + half, pCells);
+            Write(node.child[3], x + half, y + half, pCells);
+        }
+
+        void Mark(uint32_t n) noexcept
+        {
+            Node& node = m_pNodes[n];
+            if (node.marked)
+            {
+                return;
+            }
+            node.marked = true;
+            if (node.level > LeafLevel)
+            {
+                for (int i = 0; i < 4; i++)
+                {
+                    Mark(node.child[i]);
+                }
+            }
+        }
+
+        // Frees every node the faces do not reach, and forgets the results that pointed to them.
+        void Collect() noexcept
+        {
+            for (int d = 0; d < Dimension; d++)
+            {
+                Mark(m_Root[d]);
+            }
+
+            std::memset(m_pBuckets, 0, sizeof(uint32_t) * (m_BucketMask + 1));
+            m_FreeList = 0;
+            m_Count = 0;
+            for (int n = m_Top - 1; n > 0; n--)
+            {
+                Node& node = m_pNodes[n];
+                if (node.marked)
+                {
+                    uint32_t& bucket = m_pBuckets[Hash(node.child[0], node.child[1], node.child[2], node.child[3], node.level) & m_BucketMask];
+                    node.next = bucket;
+                    bucket = n;
+                    m_Count++;
+                }
+                else
+                {
+                    node.level = FreeLevel;
+                    node.next = m_FreeList;
+                    m_FreeList = n;
+                }
+            }
+
+            for (int n = 1; n < m_Top; n++)
+            {
+                Node& node = m_pNodes[n];
+                if (node.level != FreeLevel && node.result != 0 && !m_pNodes[node.result].marked)
+                {
+                    node.result = 0;
+                }
+            }
+            for (int n = 1; n < m_Top; n++)
+            {
+                m_pNodes[n].marked = false;
+            }
+        }
+
+        int m_Length;
+        int m_Level;
+        int m_Words;
+        int m_Capacity;
+        uint32_t m_BucketMask;
+        Node* m_pNodes;
+        uint32_t* m_pBuckets;
+        uint32_t* m_pCells;
+        uint32_t m_Root[Dimension] = {};
+        int m_Top = 1;
+        int m_Count = 0;
+        uint32_t m_FreeList = 0;
+        int m_Step = 0;
+        uint64_t m_Generation = 0;
+    };
+
+}
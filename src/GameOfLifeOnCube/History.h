@@ -0,0 +1,292 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "Type.h"
+
+namespace Gol3d {
+
+    // The last generations of the six faces, for rewinding.
+    //
+    // Every generation is stored as the XOR against the one before, every KeyframeInterval-th one as is,
+    // both run-length encoded (runs of zero words are what XOR deltas are made of). Rebuilding a generation
+    // decodes its keyframe and at most KeyframeInterval - 1 deltas. The oldest generations are dropped
+    // when either the count or the bytes handed to the constructor run out.
+    class History
+    {
+    public:
+        static const int Dimension = GameOfLifeDimension;
+
+        // Bytes of buffer needed for the bookkeeping of generations of col x row faces, plus one keyframe.
+        static constexpr size_t GetMinimumSize(int col, int row, int generations) noexcept
+        {
+            return sizeof(Entry) * generations + sizeof(uint32_t) * (3 * GetFrameWordCount(col, row) + 2 * GetEncodedWordCount(col, row));
+        }
+
+        // pBuffer must hold bytes (at least GetMinimumSize(col, row, generations)) aligned for uint32_t,
+        // and outlive the instance.
+        History(int col, int row, int generations, int keyframeInterval, void* pBuffer, size_t bytes) noexcept
+        : m_Col(col)
+        , m_Row(row)
+        , m_Words(detail::GetWordCount(col))
+        , m_LastMask((col & 31) == 0 ? ~0u : (1u << (col & 31)) - 1)
+        , m_FrameWords(GetFrameWordCount(col, row))
+        , m_Capacity(generations)
+        , m_KeyframeInterval(keyframeInterval)
+        {
+            uint8_t* p = static_cast<uint8_t*>(pBuffer);
+            m_pEntries = reinterpret_cast<Entry*>(p);
+            p += sizeof(Entry) * generations;
+            m_pLast = reinterpret_cast<uint32_t*>(p);
+            m_pFrame = m_pLast + m_FrameWords;
+            m_pDelta = m_pFrame + m_FrameWords;
+            m_pEncoded = m_pDelta + m_FrameWords;
+            m_pData = m_pEncoded + GetEncodedWordCount(col, row);
+            m_DataWords = static_cast<int>((bytes - sizeof(Entry) * generations) / sizeof(uint32_t)) - 3 * m_FrameWords - GetEncodedWordCount(col, row);
+        }
+
+        void Clear() noexcept
+        {
+            m_First = 0;
+            m_Count = 0;
+            m_Head = 0;
+        }
+
+        // generations that can be rebuilt, the newest one has age 0
+        int GetCount() const noexcept
+        {
+            return m_Count;
+        }
+
+        // Stores the current generation of a GameOfLifeImpl (or anything with GetCurrent(d) of the same size).
+        template <typename Life>
+        void Push(const Life& life) noexcept
+        {
+            if (m_Count == m_Capacity)
+            {
+                DropOldest();
+            }
+
+            bool keyframe = m_Count == 0 || m_SinceKeyframe + 1 >= m_KeyframeInterval;
+            for (int d = 0; d < Dimension; d++)
+            {
+                const Bitmap bitmap = life.GetCurrent(d);
+                for (int y = 0; y < m_Row; y++)
+                {
+                    const uint32_t* pRow = bitmap.pRows + y * bitmap.stride;
+                    const int offset = (d * m_Row + y) * m_Words;
+                    for (int w = 0; w < m_Words; w++)
+                    {
+                        const uint32_t word = pRow[w] & (w == m_Words - 1 ? m_LastMask : ~0u);
+                        m_pDelta[offset + w] = keyframe ? word : word ^ m_pLast[offset + w];
+                        m_pLast[offset + w] = word;
+                    }
+                }
+            }
+
+            int length = Encode(m_pDelta, m_pEncoded);
+            int offset = Allocate(length);
+            if (offset >= 0 && m_Count == 0 && !keyframe)
+            {
+                // making room dropped the generation the delta is against
+                keyframe = true;
+                length = Encode(m_pLast, m_pEncoded);
+                offset = Allocate(length);
+            }
+            if (offset < 0)
+            {
+                // not even a keyframe fits
+                Clear();
+                return;
+            }
+            std::memcpy(m_pData + offset, m_pEncoded, sizeof(uint32_t) * length);
+
+            m_pEntries[(m_First + m_Count) % m_Capacity] = { static_cast<uint32_t>(offset), static_cast<uint32_t>(length), keyframe };
+            m_Count++;
+            m_Head = offset + length;
+            m_SinceKeyframe = keyframe ? 0 : m_SinceKeyframe + 1;
+        }
+
+        // Rebuilds the generation of the age (0 .. GetCount() - 1), GetFace() reads it until the next call.
+        bool Rebuild(int age) noexcept
+        {
+            if (age < 0 || age >= m_Count)
+            {
+                return false;
+            }
+
+            const int target = m_Count - 1 - age;
+            int keyframe = target;
+            while (!GetEntry(keyframe).keyframe)
+            {
+                keyframe--;
+            }
+            for (int i = keyframe; i <= target; i++)
+            {
+                Decode(GetEntry(i), m_pFrame, i != keyframe);
+            }
+            return true;
+        }
+
+        Bitmap GetFace(int d) const noexcept
+        {
+            return { m_pFrame + d * m_Row * m_Words, m_Words, m_Col, m_Row };
+        }
+
+        // Rebuilds the generation of the age into life (GameOfLifeImpl::SetCurrent()), and forgets the ones after it.
+        template <typename Life>
+        bool Rewind(int age, Life& life) noexcept
+        {
+            if (!Rebuild(age))
+            {
+                return false;
+            }
+            for (int d = 0; d < Dimension; d++)
+            {
+                life.SetCurrent(d, GetFace(d));
+            }
+
+            m_Count -= age;
+            const Entry& newest = GetEntry(m_Count - 1);
+            m_Head = newest.offset + newest.length;
+            std::memcpy(m_pLast, m_pFrame, sizeof(uint32_t) * m_FrameWords);
+            m_SinceKeyframe = 0;
+            for (int i = m_Count - 1; !GetEntry(i).keyframe; i--)
+            {
+                m_SinceKeyframe++;
+            }
+            return true;
+        }
+
+    private:
+        struct Entry
+        {
+            uint32_t offset; // words into m_pData
+            uint32_t length; // words
+            bool keyframe;
+        };
+
+        // A run is a word holding zeros << 16 | literals, followed by the literal words.
+        static const int MaxRun = 0xFFFF;
+
+        static constexpr int GetFrameWordCount(int col, int row) noexcept
+        {
+            return Dimension * row * detail::GetWordCount(col);
+        }
+
+        // the longest a frame can be encoded to, every run but the first consumes a zero word
+        static constexpr int GetEncodedWordCount(int col, int row) noexcept
+        {
+            return GetFrameWordCount(col, row) + 2 + GetFrameWordCount(col, row) / MaxRun;
+        }
+
+        const Entry& GetEntry(int i) const noexcept
+        {
+            return m_pEntries[(m_First + i) % m_Capacity];
+        }
+
+        int Encode(const uint32_t* pFrame, uint32_t* pEncoded) const noexcept
+        {
+            int length = 0;
+            int i = 0;
+            while (i < m_FrameWords)
+            {
+                int zeros = 0;
+                while (i < m_FrameWords && pFrame[i] == 0 && zeros < MaxRun)
+                {
+                    zeros++;
+                    i++;
+                }
+                int literals = 0;
+                uint32_t* pRun = pEncoded + length++;
+                while (i < m_FrameWords && pFrame[i] != 0 && literals < MaxRun)
+                {
+                    pEncoded[length++] = pFrame[i++];
+                    literals++;
+                }
+                *pRun = (static_cast<uint32_t>(zeros) << 16) | literals;
+            }
+            return length;
+        }
+
+        void Decode(const Entry& entry, uint32_t* pFrame, bool delta) const noexcept
+        {
+            if (!delta)
+            {
+                std::memset(pFrame, 0, sizeof(uint32_t) * m_FrameWords);
+            }
+            const uint32_t* pEncoded = m_pData + entry.offset;
+            int i = 0;
+            for (uint32_t k = 0; k < entry.length;)
+            {
+                const uint32_t run = pEncoded[k++];
+                i += run >> 16;
+                for (uint32_t n = 0; n < (run & 0xFFFF); n++)
+                {
+                    pFrame[i++] ^= pEncoded[k++];
+                }
+            }
+        }
+
+        // Finds room for length words after the newest entry (or at the start of the data once the end is
+        // reached), dropping the oldest entries in the way. -1 when the data is too small.
+        int Allocate(int length) noexcept
+        {
+            if (length > m_DataWords)
+            {
+                return -1;
+            }
+            const int offset = m_Head + length <= m_DataWords ? m_Head : 0;
+            while (m_Count > 0 && IsInUse(offset, length))
+            {
+                DropOldest();
+            }
+            return offset;
+        }
+
+        bool IsInUse(int offset, int length) const noexcept
+        {
+            for (int i = 0; i < m_Count; i++)
+            {
+                const Entry& entry = GetEntry(i);
+                if (static_cast<int>(entry.offset) < offset + length && offset < static_cast<int>(entry.offset + entry.length))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // The oldest generation goes, and the deltas that lose their keyframe with it.
+        void DropOldest() noexcept
+        {
+            do
+            {
+                m_First = (m_First + 1) % m_Capacity;
+                m_Count--;
+            }
+            while (m_Count > 0 && !GetEntry(0).keyframe);
+        }
+
+        int m_Col;
+        int m_Row;
+        int m_Words;
+        uint32_t m_LastMask;
+        int m_FrameWords;
+        int m_Capacity;
+        int m_KeyframeInterval;
+        Entry* m_pEntries;
+        uint32_t* m_pLast;    // the newest generation as pushed
+        uint32_t* m_pFrame;   // the rebuilt generation
+        uint32_t* m_pDelta;
+        uint32_t* m_pEncoded;
+        uint32_t* m_pData;
+        int m_DataWords;
+        int m_First = 0;
+        int m_Count = 0;
+        int m_Head = 0;
+        int m_SinceKeyframe = 0;
+    };
+
+}
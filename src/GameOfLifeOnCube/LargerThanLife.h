@@ -0,0 +1,358 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "Type.h"
+#include "GameOfLife.h"
+#include "Parallel.h"
+#include "Random.h"
+
+namespace Gol3d {
+
+    // Larger than Life rules ("Rr,C0,Mm,Ss1..s2,Bb1..b2,NM" in Golly): a cell counts the live cells of the
+    // (2r + 1) x (2r + 1) box around it, itself included when m is 1, survives with s1 .. s2 and is born with b1 .. b2.
+    // Bits 0 - 3 hold r, bit 4 m, and 9 bits each s1, s2, b1 and b2 from bit 8 on.
+    constexpr uint64_t LargerThanLifeRule(int radius, int sMin, int sMax, int bMin, int bMax, bool middle = true)
+    {
+        return static_cast<uint64_t>(radius) | (static_cast<uint64_t>(middle) << 4) |
+               (static_cast<uint64_t>(sMin) << 8) | (static_cast<uint64_t>(sMax) << 17) |
+               (static_cast<uint64_t>(bMin) << 26) | (static_cast<uint64_t>(bMax) << 35);
+    }
+
+    constexpr const uint64_t BugsRule = LargerThanLifeRule(5, 34, 58, 34, 45);
+    constexpr const uint64_t MajorityRule = LargerThanLifeRule(4, 41, 81, 41, 81);
+    constexpr const uint64_t LargerConwayRule = LargerThanLifeRule(1, 2, 3, 3, 3, false); // B3/S23
+
+    // Six faces of Col x Row cells like GameOfLifeImpl (the same topologies and Randomize()), stepped by a
+    // Larger than Life rule of radius 1 .. MaxRadius.
+    //
+    // Every Next() lays each face out as bytes with a halo Radius cells deep, taken from the faces around it
+    // (three faces meet at a stitched cube corner, so the corner squares of the halo stay dead unless the
+    // face is a torus). The box counts then come from sliding sums: a running sum per column over the
+    // 2r + 1 rows around the current row, and a running sum along the row over those, so that a cell costs
+    // the same few additions whatever the radius. The cells themselves are kept packed as in Bitmap.
+    // All storage comes from the arena handed to the constructor.
+    template <uint64_t Rule>
+    class LargerThanLifeImpl
+    {
+    public:
+        static const int Dimension = GameOfLifeDimension;
+        static const int MaxRadius = 10;
+        static const int Radius = Rule & 0xF;
+        static const bool Middle = ((Rule >> 4) & 1) != 0;
+        static const int SurvivalMin = (Rule >> 8) & 0x1FF;
+        static const int SurvivalMax = (Rule >> 17) & 0x1FF;
+        static const int BirthMin = (Rule >> 26) & 0x1FF;
+        static const int BirthMax = (Rule >> 35) & 0x1FF;
+        static const int MinLength = 16;
+
+        static_assert(Radius >= 1 && Radius <= MaxRadius, "radius 1 .. 10");
+        static_assert(BirthMin > 0, "an empty region has to stay empty");
+
+        // Bytes of arena needed for faces of col x row cells (MinLength or more).
+        static constexpr size_t GetArenaSize(int col, int row) noexcept
+        {
+            return sizeof(uint32_t) * Dimension * row * detail::GetWordCount(col) +
+                   sizeof(uint16_t) * Dimension * (col + 2 * Radius) +
+                   sizeof(uint8_t) * Dimension * (col + 2 * Radius) * (row + 2 * Radius);
+        }
+
+        // pArena must hold GetArenaSize(col, row) bytes aligned for uint32_t, and outlive the instance.
+        LargerThanLifeImpl(int col, int row, void* pArena, long seed) noexcept
+        : m_Col(col)
+        , m_Row(row)
+        , m_Words(detail::GetWordCount(col))
+        , m_Width(col + 2 * Radius)
+        , m_LastMask((col & 31) == 0 ? ~0u : (1u << (col & 31)) - 1)
+        , m_Rnd(seed)
+        {
+            std::memset(pArena, 0, GetArenaSize(col, row));
+            uint8_t* p = static_cast<uint8_t*>(pArena);
+            m_pCells = reinterpret_cast<uint32_t*>(p);
+            p += sizeof(uint32_t) * Dimension * row * m_Words;
+            m_pColumnSums = reinterpret_cast<uint16_t*>(p);
+            p += sizeof(uint16_t) * Dimension * m_Width;
+            m_pPadded = p;
+
+            Randomize();
+        }
+
+        // Returns false when no generation was stepped: randomized or paused.
+        bool Next() noexcept
+        {
+            if ((m_State & 0x0010) == 0x0010)
+            {
+                Randomize();
+                m_State = (m_State & 0x0001);
+                return false;
+            }
+            else if ((m_State & 0x0001) == 0x0001)
+            {
+                return false;
+            }
+
+            // every face is laid out before any of them is stepped, the halo reads the packed cells of the others
+            if (m_pParallel != nullptr)
+            {
+                m_pParallel->For(Dimension, LayOutTask, this);
+                m_pParallel->For(Dimension, StepTask, this);
+            }
+            else
+            {
+                for (int d = 0; d < Dimension; d++)
+                {
+                    LayOutFace(d);
+                }
+                for (int d = 0; d < Dimension; d++)
+                {
+                    StepFace(d);
+                }
+            }
+            m_Generation++;
+            return true;
+        }
+
+        Bitmap GetCurrent(int d) const noexcept
+        {
+            return { GetFace(d), m_Words, m_Col, m_Row };
+        }
+
+        // Replaces the cells of the face d, bitmap has to be GetCol() x GetRow().
+        void SetCurrent(int d, const Bitmap& bitmap) noexcept
+        {
+            uint32_t* pFace = GetFace(d);
+            for (int y = 0; y < m_Row; y++)
+            {
+                std::memcpy(pFace + y * m_Words, bitmap.pRows + y * bitmap.stride, sizeof(uint32_t) * m_Words);
+                pFace[y * m_Words + m_Words - 1] &= m_LastMask;
+            }
+            m_Revision++;
+        }
+
+        // generations stepped since the start
+        uint64_t GetGeneration() const noexcept
+        {
+            return m_Generation;
+        }
+
+        // Counts the changes of the cells that are no generation (Randomize(), SetCurrent()), see GameOfLifeImpl::GetRevision().
+        uint64_t GetRevision() const noexcept
+        {
+            return m_Revision;
+        }
+
+        int GetCol() const noexcept
+        {
+            return m_Col;
+        }
+
+        int GetRow() const noexcept
+        {
+            return m_Row;
+        }
+
+        void SetState(int state) noexcept
+        {
+            switch (state)
+            {
+                case 0:
+                    m_State = m_State & 0x1110;
+                    return;
+                case 1:
+                    m_State = m_State | 0x0001;
+                    return;
+                case 2:
+                    m_State = m_State | 0x0010;
+                    return;
+                default:
+                    return;
+            }
+        }
+
+        // The chance of a cell to start alive on Randomize(), in 1 / 65536 (see DensityFromPercent()).
+        void SetDensity(uint32_t density) noexcept
+        {
+            m_Density = density;
+        }
+
+        // The same seed and density give the same cells on the next Randomize().
+        void SetSeed(long seed) noexcept
+        {
+            m_Rnd.Seed(seed);
+        }
+
+        // Spreads Next() over the cores a face at a time, nullptr steps on the calling thread only.
+        void SetParallel(IParallel* pParallel) noexcept
+        {
+            m_pParallel = pParallel;
+        }
+
+        // The stitched topology needs square faces, it is ignored otherwise.
+        void SetTopology(Topology topology) noexcept
+        {
+            if (topology == Topology::Stitched && m_Col != m_Row)
+            {
+                return;
+            }
+            m_Topology = topology;
+        }
+
+    private:
+        uint32_t* GetFace(int d) const noexcept
+        {
+            return m_pCells + d * m_Row * m_Words;
+        }
+
+        // the byte of the cell (x, y) of the padded face, x and y from -Radius on
+        uint8_t* GetPadded(int d, int x, int y) const noexcept
+        {
+            return m_pPadded + d * m_Width * (m_Row + 2 * Radius) + (y + Radius) * m_Width + (x + Radius);
+        }
+
+        bool GetCell(int d, int x, int y) const noexcept
+        {
+            return ((GetFace(d)[y * m_Words + (x >> 5)] >> (x & 31)) & 1) != 0;
+        }
+
+        void Randomize() noexcept
+        {
+            // whole words of cells, face after face as GameOfLifeImpl does
+            for (int d = 0; d < Dimension; d++)
+            {
+                uint32_t* pFace = GetFace(d);
+                for (int y = 0; y < m_Row; y++)
+                {
+                    for (int w = 0; w < m_Words; w++)
+                    {
+                        pFace[y * m_Words + w] = detail::RandomWord(m_Rnd, m_Density);
+                    }
+                    pFace[y * m_Words + m_Words - 1] &= m_LastMask;
+                }
+            }
+            m_Revision++;
+        }
+
+        // the cell (x, y) of the face d up to Radius cells beyond an edge (see detail::LocateCell())
+        bool GetHaloCell(int d, int x, int y) const noexcept
+        {
+            return detail::LocateCell(m_Topology, m_Col, m_Row, d, x, y) && GetCell(d, x, y);
+        }
+
+        static void LayOutTask(void* pContext, int index) noexcept
+        {
+            static_cast<LargerThanLifeImpl*>(pContext)->LayOutFace(index);
+        }
+
+        // a byte per cell of the face and of its halo
+        void LayOutFace(int d) noexcept
+        {
+            for (int y = 0; y < m_Row; y++)
+            {
+                const uint32_t* pRow = GetFace(d) + y * m_Words;
+                uint8_t* pPadded = GetPadded(d, 0, y);
+                for (int x = 0; x < m_Col; x++)
+                {
+                    pPadded[x] = (pRow[x >> 5] >> (x & 31)) & 1;
+                }
+                for (int x = 1; x <= Radius; x++)
+                {
+                    pPadded[-x] = GetHaloCell(d, -x, y);
+                    pPadded[m_Col - 1 + x] = GetHaloCell(d, m_Col - 1 + x, y);
+                }
+            }
+            for (int y = 1; y <= Radius; y++)
+            {
+                uint8_t* pAbove = GetPadded(d, 0, -y);
+                uint8_t* pBelow = GetPadded(d, 0, m_Row - 1 + y);
+                for (int x = -Radius; x < m_Col + Radius; x++)
+                {
+                    pAbove[x] = GetHaloCell(d, x, -y);
+                    pBelow[x] = GetHaloCell(d, x, m_Row - 1 + y);
+                }
+            }
+        }
+
+        static void StepTask(void* pContext, int index) noexcept
+        {
+            static_cast<LargerThanLifeImpl*>(pContext)->StepFace(index);
+        }
+
+        void StepFace(int d) noexcept
+        {
+            const int span = 2 * Radius + 1;
+
+            // the column sums over the rows -Radius .. Radius, every padded column
+            uint16_t* pSums = m_pColumnSums + d * m_Width;
+            std::memset(pSums, 0, sizeof(uint16_t) * m_Width);
+            for (int y = -Radius; y <= Radius; y++)
+            {
+                const uint8_t* pPadded = GetPadded(d, -Radius, y);
+                for (int x = 0; x < m_Width; x++)
+                {
+                    pSums[x] += pPadded[x];
+                }
+            }
+
+            for (int y = 0; y < m_Row; y++)
+            {
+                const uint8_t* pRow = GetPadded(d, 0, y);
+                uint32_t* pOut = GetFace(d) + y * m_Words;
+
+                // the box of the cell x is the column sums x - Radius .. x + Radius, pSums[x] being column x - Radius
+                int count = 0;
+                for (int x = 0; x < span - 1; x++)
+                {
+                    count += pSums[x];
+                }
+                uint32_t word = 0;
+                for (int x = 0; x < m_Col; x++)
+                {
+                    count += pSums[x + span - 1];
+                    const int alive = pRow[x];
+                    const int neighbors = Middle ? count : count - alive;
+                    const bool next = alive ? neighbors >= SurvivalMin && neighbors <= SurvivalMax :
+                                              neighbors >= BirthMin && neighbors <= BirthMax;
+                    word |= static_cast<uint32_t>(next) << (x & 31);
+                    if ((x & 31) == 31 || x == m_Col - 1)
+                    {
+                        pOut[x >> 5] = word;
+                        word = 0;
+                    }
+                    count -= pSums[x];
+                }
+
+                // slide the column sums one row down
+                if (y + 1 < m_Row)
+                {
+                    const uint8_t* pLeaving = GetPadded(d, -Radius, y - Radius);
+                    const uint8_t* pEntering = GetPadded(d, -Radius, y + Radius + 1);
+                    for (int x = 0; x < m_Width; x++)
+                    {
+                        pSums[x] += pEntering[x] - pLeaving[x];
+                    }
+                }
+            }
+        }
+
+        const int m_Col;
+        const int m_Row;
+        const int m_Words;
+        const int m_Width; // bytes per padded row
+        const uint32_t m_LastMask;
+        // Row x m_Words words per face
+        uint32_t* m_pCells;
+        uint16_t* m_pColumnSums;
+        // (Row + 2 Radius) x (Col + 2 Radius) bytes per face
+        uint8_t* m_pPadded;
+        IParallel* m_pParallel = nullptr;
+
+        detail::Xoshiro128 m_Rnd;
+        uint32_t m_Density = DefaultDensity;
+        int m_State = 0; // bit1: 0 = Start, 1 = Pause, bit2: Randomize
+        uint64_t m_Generation = 0;
+        uint64_t m_Revision = 0;
+        Topology m_Topology = Topology::Torus;
+    };
+
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#if !defined(ARDUINO)
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
+namespace Gol3d {
+
+    typedef void (*ParallelWork)(void* pContext, int index);
+
+    // Runs work for every index 0 .. count - 1 on any core, and returns when all of them are done.
+    // The order of the indices is unspecified, the work must not depend on it.
+    class IParallel
+    {
+    public:
+        virtual ~IParallel() noexcept {}
+        virtual void For(int count, ParallelWork work, void* pContext) noexcept = 0;
+    };
+
+#if !defined(ARDUINO)
+
+    // Host threads that wait for For(), the calling thread takes part in the work.
+    class ThreadPool : public IParallel
+    {
+    public:
+        // threads 0 is one per hardware thread
+        explicit ThreadPool(int threads = 0) noexcept
+        {
+            const int count = threads > 0 ? threads : static_cast<int>(std::thread::hardware_concurrency());
+            for (int i = 1; i < count; i++)
+            {
+                m_Threads.emplace_back([this]() { Work(); });
+            }
+        }
+
+        virtual ~ThreadPool() noexcept
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Stop = true;
+            }
+            m_Start.notify_all();
+            for (auto& thread : m_Threads)
+            {
+                thread.join();
+            }
+        }
+
+        virtual void For(int count, ParallelWork work, void* pContext) noexcept final
+        {
+            if (m_Threads.empty() || count <= 1)
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    work(pContext, i);
+                }
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Work = work;
+                m_pContext = pContext;
+                m_Count = count;
+                m_Next = 0;
+                m_Busy = static_cast<int>(m_Threads.size());
+                m_Round++;
+            }
+            m_Start.notify_all();
+            Run();
+
+            // every thread has to leave Run() before the next round may reset m_Next
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Done.wait(lock, [this]() { return m_Busy == 0; });
+        }
+
+        int GetThreadCount() const noexcept
+        {
+            return static_cast<int>(m_Threads.size()) + 1;
+        }
+
+    private:
+        void Run() noexcept
+        {
+            for (int i = m_Next++; i < m_Count; i = m_Next++)
+            {
+                m_Work(m_pContext, i);
+            }
+        }
+
+        void Work() noexcept
+        {
+            unsigned round = 0;
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m_Mutex);
+                    m_Start.wait(lock, [&]() { return m_Stop || m_Round != round; });
+                    if (m_Stop)
+                    {
+                        return;
+                    }
+                    round = m_Round;
+                }
+
+                Run();
+
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if (--m_Busy == 0)
+                {
+                    m_Done.notify_one();
+                }
+            }
+        }
+
+        std::vector<std::thread> m_Threads;
+        std::mutex m_Mutex;
+        std::condition_variable m_Start;
+        std::condition_variable m_Done;
+        ParallelWork m_Work = nullptr;
+        void* m_pContext = nullptr;
+        int m_Count = 0;
+        std::atomic<int> m_Next { 0 };
+        int m_Busy = 0;
+        unsigned m_Round = 0;
+        bool m_Stop = false;
+    };
+
+#endif
+
+}
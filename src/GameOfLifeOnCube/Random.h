@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Gol3d {
+
+    // Densities are fractions of 65536, the chance of a cell to start alive.
+    constexpr uint32_t DensityFromPercent(int percent)
+    {
+        return (static_cast<uint32_t>(percent) * 65536 + 50) / 100;
+    }
+
+    constexpr const uint32_t DefaultDensity = DensityFromPercent(10);
+
+namespace detail {
+
+    // xoshiro128** (Blackman and Vigna), 32 random bits a call and cheap on the ESP32.
+    class Xoshiro128
+    {
+    public:
+        explicit Xoshiro128(long seed) noexcept
+        {
+            Seed(seed);
+        }
+
+        // the state is spread from the seed with splitmix64, so that close seeds give unrelated sequences
+        void Seed(long seed) noexcept
+        {
+            uint64_t x = static_cast<uint64_t>(seed);
+            for (int i = 0; i < 4; i += 2)
+            {
+                x += 0x9E3779B97F4A7C15ull;
+                uint64_t z = x;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                z ^= z >> 31;
+                m_State[i] = static_cast<uint32_t>(z);
+                m_State[i + 1] = static_cast<uint32_t>(z >> 32);
+            }
+        }
+
+        uint32_t operator()() noexcept
+        {
+            const uint32_t result = Rotate(m_State[1] * 5, 7) * 9;
+            const uint32_t t = m_State[1] << 9;
+            m_State[2] ^= m_State[0];
+            m_State[3] ^= m_State[1];
+            m_State[1] ^= m_State[2];
+            m_State[0] ^= m_State[3];
+            m_State[2] ^= t;
+            m_State[3] = Rotate(m_State[3], 11);
+            return result;
+        }
+
+    private:
+        static uint32_t Rotate(uint32_t x, int k) noexcept
+        {
+            return (x << k) | (x >> (32 - k));
+        }
+
+        uint32_t m_State[4];
+    };
+
+    // 32 cells, each alive with the chance density / 65536.
+    // The bits of density are read from the lowest set one up: a 1 ORs the next random word in (p -> (1 + p) / 2),
+    // a 0 ANDs it in (p -> p / 2), which leaves every bit set with the chance 0.b15 b14 ... b0.
+    inline uint32_t RandomWord(Xoshiro128& rnd, uint32_t density) noexcept
+    {
+        if (density == 0)
+        {
+            return 0;
+        }
+        if (density >= 65536)
+        {
+            return ~0u;
+        }
+
+        int bit = __builtin_ctz(density);
+        uint32_t word = rnd();
+        for (bit++; bit < 16; bit++)
+        {
+            word = ((density >> bit) & 1) ? word | rnd() : word & rnd();
+        }
+        return word;
+    }
+
+}
+
+}
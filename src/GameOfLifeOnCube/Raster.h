@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "Type.h"
+
+namespace Gol3d {
+
+    // The pixels x0 .. x1 - 1 of the row y of a parallelogram, the texel (u, v) under the center of the pixel x0
+    // and the step to the next pixel, 16.16 fixed point.
+    struct Span
+    {
+        int y;
+        int x0;
+        int x1;
+        int32_t u;
+        int32_t v;
+        int32_t du;
+        int32_t dv;
+    };
+
+namespace detail {
+
+    // the centers c of the pixels of a row with 0 <= a + b c < length, narrowed from [lo, hi)
+    inline void NarrowSpan(float a, float b, float length, float& lo, float& hi) noexcept
+    {
+        if (b == 0.0F)
+        {
+            hi = (a < 0.0F || a >= length) ? lo : hi;
+            return;
+        }
+        const float first = -a / b;
+        const float last = (length - a) / b;
+        lo = std::fmax(lo, b > 0.0F ? first : last);
+        hi = std::fmin(hi, b > 0.0F ? last : first);
+    }
+
+    inline int32_t ClampFixed(float value, int length) noexcept
+    {
+        const int32_t fixed = static_cast<int32_t>(value * 65536.0F);
+        return fixed < 0 ? 0 : fixed >= (length << 16) ? (length << 16) - 1 : fixed;
+    }
+
+}
+
+    // Calls span(const Span&) for every row of the parallelogram that puts a texture of texture.width x
+    // texture.height texels on dst[0] (top left corner), dst[1] (top right) and dst[2] (bottom left), clipped
+    // to the pixels of clip. Pixels are sampled at their centers, u and v stay inside the texture.
+    template <typename SpanFunction>
+    void RasterizeParallelogram(const FPosition dst[3], Rect texture, Rect clip, SpanFunction span) noexcept
+    {
+        const float e1x = dst[1].x - dst[0].x;
+        const float e1y = dst[1].y - dst[0].y;
+        const float e2x = dst[2].x - dst[0].x;
+        const float e2y = dst[2].y - dst[0].y;
+        const float det = e1x * e2y - e1y * e2x;
+        if (std::fabs(det) < 1.0F)
+        {
+            return; // edge-on, thinner than a pixel
+        }
+
+        // u = ux x + uy y + uc, v likewise, at the pixel center (x, y)
+        const float ux = e2y * texture.width / det;
+        const float uy = -e2x * texture.width / det;
+        const float uc = -(ux * dst[0].x + uy * dst[0].y);
+        const float vx = -e1y * texture.height / det;
+        const float vy = e1x * texture.height / det;
+        const float vc = -(vx * dst[0].x + vy * dst[0].y);
+
+        const float top = std::fmin(std::fmin(dst[0].y, dst[1].y), std::fmin(dst[2].y, dst[1].y + e2y));
+        const float bottom = std::fmax(std::fmax(dst[0].y, dst[1].y), std::fmax(dst[2].y, dst[1].y + e2y));
+        const int yBegin = std::max(0, static_cast<int>(std::floor(top)));
+        const int yEnd = std::min(clip.height, static_cast<int>(std::ceil(bottom)));
+        for (int y = yBegin; y < yEnd; y++)
+        {
+            const float cy = y + 0.5F;
+            float lo = 0.5F;
+            float hi = clip.width + 0.5F;
+            detail::NarrowSpan(uy * cy + uc, ux, static_cast<float>(texture.width), lo, hi);
+            detail::NarrowSpan(vy * cy + vc, vx, static_cast<float>(texture.height), lo, hi);
+            const int x0 = static_cast<int>(std::ceil(lo - 0.5F));
+            const int x1 = std::min(clip.width, static_cast<int>(std::ceil(hi - 0.5F)));
+            if (x0 >= x1)
+            {
+                continue;
+            }
+
+            // stepping between the clamped ends keeps rounding from leaving the texture
+            const float cx0 = x0 + 0.5F;
+            const float cx1 = x1 - 0.5F;
+            const int32_t u0 = detail::ClampFixed(ux * cx0 + uy * cy + uc, texture.width);
+            const int32_t v0 = detail::ClampFixed(vx * cx0 + vy * cy + vc, texture.height);
+            const int32_t u1 = detail::ClampFixed(ux * cx1 + uy * cy + uc, texture.width);
+            const int32_t v1 = detail::ClampFixed(vx * cx1 + vy * cy + vc, texture.height);
+            const int steps = x1 - 1 - x0;
+            span(Span { y, x0, x1, u0, v0, steps > 0 ? (u1 - u0) / steps : 0, steps > 0 ? (v1 - v0) / steps : 0 });
+        }
+    }
+
+}
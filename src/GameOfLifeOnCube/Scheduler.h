@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Gol3d {
+
+    typedef unsigned long (*GetMicros)();
+
+    // Runs generations at a fixed rate whatever the frame rate is, or as many as fit in a frame (turbo).
+    class Scheduler
+    {
+    public:
+        static const int Turbo = 0;
+        // generations a frame may run to catch up, the rest of a longer stall is dropped
+        static const int MaxCatchUp = 8;
+
+        Scheduler(GetMicros getMicros, int generationsPerSecond, unsigned long turboBudget = 20000) noexcept
+        : m_GetMicros(getMicros)
+        , m_Rate(generationsPerSecond)
+        , m_TurboBudget(turboBudget)
+        , m_Last(getMicros())
+        {
+        }
+
+        // generations per second, Turbo to step for turboBudget microseconds every frame
+        void SetRate(int generationsPerSecond) noexcept
+        {
+            m_Rate = generationsPerSecond;
+            m_Accumulated = 0;
+            m_Last = m_GetMicros();
+        }
+
+        int GetRate() const noexcept
+        {
+            return m_Rate;
+        }
+
+        // Calls step() as often as the time since the last call asks for, and returns how many generations it
+        // stepped. step() returns false when it had nothing to step (paused, or replaying a cycle), which ends
+        // a turbo frame instead of spinning through the rest of the budget.
+        template <typename Step>
+        int Run(Step step) noexcept
+        {
+            const unsigned long now = m_GetMicros();
+            int count = 0;
+            if (m_Rate == Turbo)
+            {
+                while (step())
+                {
+                    count++;
+                    if (m_GetMicros() - now >= m_TurboBudget)
+                    {
+                        break;
+                    }
+                }
+                m_Last = now;
+                return count;
+            }
+
+            // a generation is due every 1000000 / m_Rate microseconds, kept as microseconds x m_Rate
+            m_Accumulated += static_cast<uint64_t>(now - m_Last) * m_Rate;
+            m_Last = now;
+            for (int calls = 0; m_Accumulated >= 1000000 && calls < MaxCatchUp; calls++)
+            {
+                count += step() ? 1 : 0;
+                m_Accumulated -= 1000000;
+            }
+            m_Accumulated %= 1000000;
+            return count;
+        }
+
+    private:
+        GetMicros m_GetMicros;
+        int m_Rate;
+        unsigned long m_TurboBudget;
+        unsigned long m_Last;
+        uint64_t m_Accumulated = 0;
+    };
+
+}
@@ -0,0 +1,723 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "Type.h"
+#include "GameOfLife.h"
+#include "StepKernel.h"
+#include "Parallel.h"
+
+namespace Gol3d {
+
+    // Six faces of Col x Row cells like GameOfLifeImpl (the same rule, topologies and halo cells),
+    // stored as blocks of 32 x 32 cells for faces far too large to be stored whole and mostly empty.
+    //
+    // Only blocks with live cells, or next to live cells, exist. They come from a pool of fixed
+    // capacity carved from the arena and are found through an open addressing table; a block that
+    // stayed empty for two generations without being needed goes back to the pool.
+    template <uint32_t Rule>
+    class SparseLifeImpl
+    {
+        static_assert((Rule & 1) == 0, "an empty region has to stay empty");
+
+    public:
+        static const int Dimension = GameOfLifeDimension;
+        static const int BlockSize = 32;
+        static const int MinLength = 16;
+        static const int MaxLength = 1 << 19; // 14 bits of block column and row in a key
+        static const int TaskBlocks = 16;
+
+        // Bytes of arena needed for a pool of blockCapacity blocks.
+        static constexpr size_t GetArenaSize(int blockCapacity) noexcept
+        {
+            return sizeof(Block) * blockCapacity +
+                   sizeof(uint32_t) * blockCapacity +
+                   sizeof(uint32_t) * GetSlotCount(2 * blockCapacity);
+        }
+
+        // pArena must hold GetArenaSize(blockCapacity) bytes aligned for uint32_t, and outlive the instance.
+        // The faces start empty.
+        SparseLifeImpl(int col, int row, int blockCapacity, void* pArena) noexcept
+        : m_Col(col)
+        , m_Row(row)
+        , m_Capacity(blockCapacity)
+        , m_SlotMask(GetSlotCount(2 * blockCapacity) - 1)
+        {
+            std::memset(pArena, 0, GetArenaSize(blockCapacity));
+            uint8_t* p = static_cast<uint8_t*>(pArena);
+            m_pBlocks = reinterpret_cast<Block*>(p);
+            p += sizeof(Block) * blockCapacity;
+            m_pActive = reinterpret_cast<uint32_t*>(p);
+            p += sizeof(uint32_t) * blockCapacity;
+            m_pSlots = reinterpret_cast<uint32_t*>(p);
+
+            // the free list runs through the pool in order
+            for (int i = 0; i < blockCapacity; i++)
+            {
+                m_pBlocks[i].link = i + 1;
+            }
+        }
+
+        void Next() noexcept
+        {
+            // blocks that get cells from a neighbor have to exist before anything is stepped
+            const int count = m_Count;
+            for (int i = 0; i < count; i++)
+            {
+                EnsureNeighbors(m_pBlocks[m_pActive[i]]);
+            }
+
+            const int tasks = (m_Count + TaskBlocks - 1) / TaskBlocks;
+            if (m_pParallel != nullptr)
+            {
+                m_pParallel->For(tasks, StepTask, this);
+            }
+            else
+            {
+                for (int i = 0; i < tasks; i++)
+                {
+                    StepTask(this, i);
+                }
+            }
+            m_Front ^= 1;
+            m_Generation++;
+
+            // from the back so that moving the last block into a freed place does not skip it
+            for (int i = m_Count - 1; i >= 0; i--)
+            {
+                Block& block = m_pBlocks[m_pActive[i]];
+                block.idle = IsEmpty(block) ? block.idle + 1 : 0;
+                if (block.idle >= 2)
+                {
+                    Free(m_pActive[i]);
+                }
+            }
+        }
+
+        bool GetCell(int d, int x, int y) const noexcept
+        {
+            const Block* pBlock = Find(GetKey(d, x / BlockSize, y / BlockSize));
+            return pBlock != nullptr && ((pBlock->rows[m_Front][y % BlockSize] >> (x % BlockSize)) & 1) != 0;
+        }
+
+        // Returns false when the pool has no block left for the cell.
+        bool SetCell(int d, int x, int y, bool alive) noexcept
+        {
+            Block* pBlock = alive ? Ensure(GetKey(d, x / BlockSize, y / BlockSize)) : Find(GetKey(d, x / BlockSize, y / BlockSize));
+            if (pBlock == nullptr)
+            {
+                return !alive;
+            }
+            uint32_t& row = pBlock->rows[m_Front][y % BlockSize];
+            row = alive ? row | (1u << (x % BlockSize)) : row & ~(1u << (x % BlockSize));
+            return true;
+        }
+
+        // Replaces the cells of the face d, bitmap has to be GetCol() x GetRow() (GameOfLifeImpl::GetCurrent() fits).
+        // Returns false when the pool ran out of blocks, the cells that did not fit are dead.
+        bool SetCurrent(int d, const Bitmap& bitmap) noexcept
+        {
+            for (int i = 0; i < m_Count; i++)
+            {
+                Block& block = m_pBlocks[m_pActive[i]];
+                if (GetFace(block.key) == d)
+                {
+                    std::memset(block.rows[m_Front], 0, sizeof(block.rows[m_Front]));
+                }
+            }
+
+            bool fits = true;
+            for (int by = 0; by * BlockSize < m_Row; by++)
+            {
+                for (int bx = 0; bx * BlockSize < m_Col; bx++)
+                {
+                    const int height = GetBlockHeight(by);
+                    const uint32_t mask = GetBlockMask(bx);
+                    uint32_t rows[BlockSize] = {};
+                    uint32_t any = 0;
+                    for (int y = 0; y < height; y++)
+                    {
+                        rows[y] = bitmap.pRows[(by * BlockSize + y) * bitmap.stride + bx] & mask;
+                        any |= rows[y];
+                    }
+                    Block* pBlock = any != 0 ? Ensure(GetKey(d, bx, by)) : nullptr;
+                    if (pBlock != nullptr)
+                    {
+                        std::memcpy(pBlock->rows[m_Front], rows, sizeof(rows));
+                    }
+                    fits = fits && (any == 0 || pBlock != nullptr);
+                }
+            }
+            return fits;
+        }
+
+        // Kills every cell and gives all blocks back to the pool.
+        void Clear() noexcept
+        {
+            while (m_Count != 0)
+            {
+                Free(m_pActive[m_Count - 1]);
+            }
+        }
+
+        // Writes the cells of the face d to GetRow() rows of GetWordCount(GetCol()) words, stride words apart.
+        void CopyCurrent(int d, uint32_t* pRows, int stride) const noexcept
+        {
+            const int words = detail::GetWordCount(m_Col);
+            for (int y = 0; y < m_Row; y++)
+            {
+                std::memset(pRows + y * stride, 0, sizeof(uint32_t) * words);
+            }
+            for (int i = 0; i < m_Count; i++)
+            {
+                const Block& block = m_pBlocks[m_pActive[i]];
+                if (GetFace(block.key) != d)
+                {
+                    continue;
+                }
+                const int bx = GetBlockX(block.key);
+                const int by = GetBlockY(block.key);
+                for (int y = 0; y < GetBlockHeight(by); y++)
+                {
+                    pRows[(by * BlockSize + y) * stride + bx] = block.rows[m_Front][y];
+                }
+            }
+        }
+
+        // generations stepped since the start
+        uint64_t GetGeneration() const noexcept
+        {
+            return m_Generation;
+        }
+
+        int GetCol() const noexcept
+        {
+            return m_Col;
+        }
+
+        int GetRow() const noexcept
+        {
+            return m_Row;
+        }
+
+        // blocks in use, empty ones waiting to be freed included
+        int GetBlockCount() const noexcept
+        {
+            return m_Count;
+        }
+
+        // true once cells were lost because the pool had no block left for them
+        bool HasOverflowed() const noexcept
+        {
+            return m_Overflowed;
+        }
+
+        // Spreads Next() over the cores TaskBlocks blocks at a time, nullptr steps on the calling thread only.
+        void SetParallel(IParallel* pParallel) noexcept
+        {
+            m_pParallel = pParallel;
+        }
+
+        // The stitched topology needs square faces, it is ignored otherwise.
+        void SetTopology(Topology topology) noexcept
+        {
+            if (topology == Topology::Stitched && m_Col != m_Row)
+            {
+                return;
+            }
+            m_Topology = topology;
+        }
+
+    private:
+        struct Block
+        {
+            uint32_t rows[2][BlockSize]; // rows[m_Front] is the current generation, bit x of row y is the cell (x, y)
+            uint32_t key;
+            uint32_t link;  // the place in m_pActive, or the next free block
+            uint32_t idle;  // generations the block stayed empty and unneeded
+        };
+
+        static constexpr int GetSlotCount(int capacity, int count = 1) noexcept
+        {
+            return count >= capacity ? count : GetSlotCount(capacity, count * 2);
+        }
+
+        static uint32_t GetKey(int d, int bx, int by) noexcept
+        {
+            return (static_cast<uint32_t>(d) << 28) | (static_cast<uint32_t>(by) << 14) | static_cast<uint32_t>(bx);
+        }
+
+        static int GetFace(uint32_t key) noexcept
+        {
+            return static_cast<int>(key >> 28);
+        }
+
+        static int GetBlockX(uint32_t key) noexcept
+        {
+            return static_cast<int>(key & 0x3FFF);
+        }
+
+        static int GetBlockY(uint32_t key) noexcept
+        {
+            return static_cast<int>((key >> 14) & 0x3FFF);
+        }
+
+        uint32_t GetHome(uint32_t key) const noexcept
+        {
+            return ((key * 0x9E3779B1u) >> 7) & m_SlotMask;
+        }
+
+        // the blocks on the right and bottom end of a face may be only partly made of cells
+        int GetBlockWidth(int bx) const noexcept
+        {
+            return m_Col - bx * BlockSize < BlockSize ? m_Col - bx * BlockSize : BlockSize;
+        }
+
+        int GetBlockHeight(int by) const noexcept
+        {
+            return m_Row - by * BlockSize < BlockSize ? m_Row - by * BlockSize : BlockSize;
+        }
+
+        uint32_t GetBlockMask(int bx) const noexcept
+        {
+            const int width = GetBlockWidth(bx);
+            return width == BlockSize ? ~0u : (1u << width) - 1;
+        }
+
+        const Block* Find(uint32_t key) const noexcept
+        {
+            for (uint32_t i = GetHome(key); m_pSlots[i] != 0; i = (i + 1) & m_SlotMask)
+            {
+                const Block& block = m_pBlocks[m_pSlots[i] - 1];
+                if (block.key == key)
+                {
+                    return &block;
+                }
+            }
+            return nullptr;
+        }
+
+        Block* Find(uint32_t key) noexcept
+        {
+            return const_cast<Block*>(static_cast<const SparseLifeImpl*>(this)->Find(key));
+        }
+
+        // The block of the key, taken from the pool when there is none yet. nullptr when the pool is empty.
+        Block* Ensure(uint32_t key) noexcept
+        {
+            uint32_t i = GetHome(key);
+            for (; m_pSlots[i] != 0; i = (i + 1) & m_SlotMask)
+            {
+                Block& block = m_pBlocks[m_pSlots[i] - 1];
+                if (block.key == key)
+                {
+                    block.idle = 0;
+                    return &block;
+                }
+            }
+            if (m_Free == static_cast<uint32_t>(m_Capacity))
+            {
+                m_Overflowed = true;
+                return nullptr;
+            }
+
+            const uint32_t index = m_Free;
+            Block& block = m_pBlocks[index];
+            m_Free = block.link;
+            std::memset(block.rows, 0, sizeof(block.rows));
+            block.key = key;
+            block.link = m_Count;
+            block.idle = 0;
+            m_pActive[m_Count++] = index;
+            m_pSlots[i] = index + 1;
+            return &block;
+        }
+
+        void Free(uint32_t index) noexcept
+        {
+            Block& block = m_pBlocks[index];
+
+            // backward shift deletion keeps the probe sequences of the other keys unbroken
+            uint32_t i = GetHome(block.key);
+            while (m_pSlots[i] != index + 1)
+            {
+                i = (i + 1) & m_SlotMask;
+            }
+            for (uint32_t j = (i + 1) & m_SlotMask; m_pSlots[j] != 0; j = (j + 1) & m_SlotMask)
+            {
+                const uint32_t home = GetHome(m_pBlocks[m_pSlots[j] - 1].key);
+                if (((j - home) & m_SlotMask) >= ((j - i) & m_SlotMask))
+                {
+                    m_pSlots[i] = m_pSlots[j];
+                    i = j;
+                }
+            }
+            m_pSlots[i] = 0;
+
+            const uint32_t last = m_pActive[--m_Count];
+            m_pActive[block.link] = last;
+            m_pBlocks[last].link = block.link;
+            block.link = m_Free;
+            m_Free = index;
+        }
+
+        bool IsEmpty(const Block& block) const noexcept
+        {
+            uint32_t any = 0;
+            for (int y = 0; y < BlockSize; y++)
+            {
+                any |= block.rows[m_Front][y];
+            }
+            return any == 0;
+        }
+
+        // the cell (x, y) of the face d, which may lie a cell beyond an edge (see detail::LocateCell())
+        bool GetHaloCell(int d, int x, int y) const noexcept
+        {
+            return detail::LocateCell(m_Topology, m_Col, m_Row, d, x, y) && GetCell(d, x, y);
+        }
+
+        // Makes sure the blocks holding the halo cells next to live border cells of the block exist.
+        void EnsureNeighbors(const Block& block) noexcept
+        {
+            const int d = GetFace(block.key);
+            const int x0 = GetBlockX(block.key) * BlockSize;
+            const int y0 = GetBlockY(block.key) * BlockSize;
+            const int width = GetBlockWidth(GetBlockX(block.key));
+            const int height = GetBlockHeight(GetBlockY(block.key));
+            const uint32_t* pRows = block.rows[m_Front];
+            uint32_t any = 0;
+            for (int y = 0; y < height; y++)
+            {
+                any |= pRows[y];
+            }
+
+            uint32_t last = ~0u;
+            const auto ensure = [&](int x, int y)
+            {
+                int face = d;
+                if (detail::LocateCell(m_Topology, m_Col, m_Row, face, x, y))
+                {
+                    const uint32_t key = GetKey(face, x / BlockSize, y / BlockSize);
+                    if (key != last)
+                    {
+                        Ensure(key);
+                        last = key;
+                    }
+                }
+            };
+            if (pRows[0] != 0)
+            {
+                for (int x = -1; x <= width; x++)
+                {
+                    ensure(x0 + x, y0 - 1);
+                }
+            }
+            if (pRows[height - 1] != 0)
+            {
+                for (int x = -1; x <= width; x++)
+                {
+                    ensure(x0 + x, y0 + height);
+                }
+            }
+            if ((any & 1) != 0)
+            {
+                for (int y = -1; y <= height; y++)
+                {
+                    ensure(x0 - 1, y0 + y);
+                }
+            }
+            if (((any >> (width - 1)) & 1) != 0)
+            {
+                for (int y = -1; y <= height; y++)
+                {
+                    ensure(x0 + width, y0 + y);
+                }
+            }
+        }
+
+        static void StepTask(void* pContext, int index) noexcept
+        {
+            auto& self = *static_cast<SparseLifeImpl*>(pContext);
+            const int end = (index + 1) * TaskBlocks < self.m_Count ? (index + 1) * TaskBlocks : self.m_Count;
+            for (int i = index * TaskBlocks; i < end; i++)
+            {
+                self.StepBlock(self.m_pBlocks[self.m_pActive[i]]);
+            }
+        }
+
+        // Lays the block out like a GameOfLifeImpl face of three words a row (the left and right neighbors
+        // in the outer words, the rows above and below in rows 0 and height + 1) and steps it with the same kernel.
+        void StepBlock(Block& block) const noexcept
+        {
+            const int d = GetFace(block.key);
+            const int bx = GetBlockX(block.key);
+            const int by = GetBlockY(block.key);
+            const int x0 = bx * BlockSize;
+            const int y0 = by * BlockSize;
+            const int width = GetBlockWidth(bx);
+            const int height = GetBlockHeight(by);
+            uint32_t tile[BlockSize + 2][3] = {};
+
+            if (x0 > 0 && y0 > 0 && x0 + BlockSize < m_Col && y0 + BlockSize < m_Row)
+            {
+                // every halo cell is in a neighbor block of the same face
+                for (int j = -1; j <= 1; j++)
+                {
+                    for (int i = -1; i <= 1; i++)
+                    {
+                        const Block* pBlock = Find(GetKey(d, bx + i, by + j));
+                        if (pBlock == nullptr)
+                        {
+                            continue;
+                        }
+                        const uint32_t* pRows = pBlock->rows[m_Front];
+                        if (j == 0)
+                        {
+                            for (int y = 0; y < BlockSize; y++)
+                            {
+                                tile[y + 1][i + 1] = pRows[y];
+                            }
+                        }
+                        else
+                        {
+                            tile[j < 0 ? 0 : BlockSize + 1][i + 1] = pRows[j < 0 ? BlockSize - 1 : 0];
+                        }
+                    }
+                }
+            }
+            else
+            {
+                for (int y = 0; y < height; y++)
+                {
+                    tile[y + 1][1] = block.rows[m_Front][y];
+                }
+                for (int x = -1; x <= width; x++)
+                {
+                    SetTileCell(tile, x, -1, GetHaloCell(d, x0 + x, y0 - 1));
+                    SetTileCell(tile, x, height, GetHaloCell(d, x0 + x, y0 + height));
+                }
+                for (int y = 0; y < height; y++)
+                {
+                    SetTileCell(tile, -1, y, GetHaloCell(d, x0 - 1, y0 + y));
+                    SetTileCell(tile, width, y, GetHaloCell(d, x0 + width, y0 + y));
+                }
+            }
+
+            const uint32_t mask = GetBlockMask(bx);
+            uint32_t* pNext = block.rows[m_Front ^ 1];
+            for (int y = 0; y < height; y++)
+            {
+                pNext[y] = detail::NextWord<Rule, uint32_t>(tile[y] + 1, tile[y + 1] + 1, tile[y + 2] + 1) & mask;
+            }
+        }
+
+        // x -1 is bit 31 of the left word, BlockSize bit 0 of the right one
+        static void SetTileCell(uint32_t (&tile)[BlockSize + 2][3], int x, int y, bool alive) noexcept
+        {
+            if (alive)
+            {
+                tile[y + 1][(x + BlockSize) / BlockSize] |= 1u << ((x + BlockSize) % BlockSize);
+            }
+        }
+
+        const int m_Col;
+        const int m_Row;
+        const int m_Capacity;
+        const uint32_t m_SlotMask;
+        Block* m_pBlocks;
+        uint32_t* m_pActive; // the blocks in use, in no particular order
+        uint32_t* m_pSlots;  // block index + 1, 0 is an empty slot
+        int m_Count = 0;
+        uint32_t m_Free = 0;
+        int m_Front = 0;
+        uint64_t m_Generation = 0;
+        bool m_Overflowed = false;
+        IParallel* m_pParallel = nullptr;
+        Topology m_Topology = Topology::Torus;
+    };
+
+    // GameOfLifeImpl while the faces are busy and SparseLifeImpl once few blocks of them have live cells left,
+    // the cells handed over whenever the density crosses over.
+    //
+    // The sparse engine runs while its blocks take no more than a ninth of the pool, so the neighbors a step
+    // adds always fit and no cell is lost. It takes over again once the live blocks would fill a quarter of
+    // that, the blocks next to them come on top (and an eighth of the faces at most). The faces start as the
+    // soup of GameOfLifeImpl(col, row, ..., seed).
+    template <uint32_t Rule>
+    class AdaptiveLifeImpl
+    {
+    public:
+        typedef GameOfLifeImpl<Rule> Dense;
+        typedef SparseLifeImpl<Rule> Sparse;
+        static const int Dimension = GameOfLifeDimension;
+        static const int DenseCheckInterval = 16; // generations between two counts of the live blocks
+
+        // Bytes of arena needed for faces of col x row cells and a sparse pool of blockCapacity blocks.
+        static constexpr size_t GetArenaSize(int col, int row, int blockCapacity) noexcept
+        {
+            return GetDenseSize(col, row) + Sparse::GetArenaSize(blockCapacity) +
+                   sizeof(uint32_t) * row * detail::GetWordCount(col);
+        }
+
+        // pArena must hold GetArenaSize(col, row, blockCapacity) bytes aligned for uint64_t, and outlive the instance.
+        AdaptiveLifeImpl(int col, int row, int blockCapacity, void* pArena, long seed) noexcept
+        : m_Dense(col, row, pArena, seed)
+        , m_Sparse(col, row, blockCapacity, static_cast<uint8_t*>(pArena) + GetDenseSize(col, row))
+        , m_pRows(reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(pArena) + GetDenseSize(col, row) + Sparse::GetArenaSize(blockCapacity)))
+        , m_Words(detail::GetWordCount(col))
+        , m_MaxSparseBlocks(blockCapacity / 9)
+        , m_Total(Dimension * ((col + Sparse::BlockSize - 1) / Sparse::BlockSize) * ((row + Sparse::BlockSize - 1) / Sparse::BlockSize))
+        {
+        }
+
+        void Next() noexcept
+        {
+            if (m_IsSparse && m_Sparse.GetBlockCount() > m_MaxSparseBlocks)
+            {
+                ToDense();
+            }
+            else if (!m_IsSparse && (m_Generation % DenseCheckInterval == 0 || m_Changed))
+            {
+                m_Changed = false;
+                const int blocks = CountLiveBlocks();
+                if (4 * blocks <= m_MaxSparseBlocks && 8 * blocks <= m_Total)
+                {
+                    ToSparse();
+                }
+            }
+
+            if (m_IsSparse)
+            {
+                m_Sparse.Next();
+            }
+            else
+            {
+                m_Dense.Next();
+            }
+            m_Generation++;
+        }
+
+        // Replaces the cells of the face d, bitmap has to be GetCol() x GetRow(). They go to GameOfLifeImpl,
+        // the next generation counts them to tell which engine steps them.
+        void SetCurrent(int d, const Bitmap& bitmap) noexcept
+        {
+            if (m_IsSparse)
+            {
+                ToDense();
+            }
+            m_Dense.SetCurrent(d, bitmap);
+            m_Changed = true;
+        }
+
+        // Writes the cells of the face d to GetRow() rows of GetWordCount(GetCol()) words, stride words apart.
+        void CopyCurrent(int d, uint32_t* pRows, int stride) const noexcept
+        {
+            if (m_IsSparse)
+            {
+                m_Sparse.CopyCurrent(d, pRows, stride);
+                return;
+            }
+            const Bitmap bitmap = m_Dense.GetCurrent(d);
+            for (int y = 0; y < bitmap.height; y++)
+            {
+                std::memcpy(pRows + y * stride, bitmap.pRows + y * bitmap.stride, sizeof(uint32_t) * m_Words);
+            }
+        }
+
+        // generations stepped since the start, by either engine
+        uint64_t GetGeneration() const noexcept
+        {
+            return m_Generation;
+        }
+
+        bool IsSparse() const noexcept
+        {
+            return m_IsSparse;
+        }
+
+        // times the cells were handed from one engine to the other
+        int GetHandoffCount() const noexcept
+        {
+            return m_Handoffs;
+        }
+
+        void SetParallel(IParallel* pParallel) noexcept
+        {
+            m_Dense.SetParallel(pParallel);
+            m_Sparse.SetParallel(pParallel);
+        }
+
+        // The stitched topology needs square faces, it is ignored otherwise.
+        void SetTopology(Topology topology) noexcept
+        {
+            m_Dense.SetTopology(topology);
+            m_Sparse.SetTopology(topology);
+        }
+
+    private:
+        static constexpr size_t GetDenseSize(int col, int row) noexcept
+        {
+            return (Dense::GetArenaSize(col, row) + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+        }
+
+        // the blocks of SparseLifeImpl the cells of the dense faces would take
+        int CountLiveBlocks() const noexcept
+        {
+            int blocks = 0;
+            for (int d = 0; d < Dimension; d++)
+            {
+                const Bitmap bitmap = m_Dense.GetCurrent(d);
+                for (int by = 0; by * Sparse::BlockSize < bitmap.height; by++)
+                {
+                    const int height = bitmap.height - by * Sparse::BlockSize < Sparse::BlockSize ? bitmap.height - by * Sparse::BlockSize : Sparse::BlockSize;
+                    for (int w = 0; w < m_Words; w++)
+                    {
+                        uint32_t any = 0;
+                        for (int y = 0; y < height; y++)
+                        {
+                            any |= bitmap.pRows[(by * Sparse::BlockSize + y) * bitmap.stride + w];
+                        }
+                        blocks += any != 0 ? 1 : 0;
+                    }
+                }
+            }
+            return blocks;
+        }
+
+        void ToSparse() noexcept
+        {
+            m_Sparse.Clear();
+            for (int d = 0; d < Dimension; d++)
+            {
+                m_Sparse.SetCurrent(d, m_Dense.GetCurrent(d));
+            }
+            m_IsSparse = true;
+            m_Handoffs++;
+        }
+
+        void ToDense() noexcept
+        {
+            for (int d = 0; d < Dimension; d++)
+            {
+                m_Sparse.CopyCurrent(d, m_pRows, m_Words);
+                m_Dense.SetCurrent(d, { m_pRows, m_Words, m_Dense.GetCol(), m_Dense.GetRow() });
+            }
+            m_IsSparse = false;
+            m_Handoffs++;
+        }
+
+        Dense m_Dense;
+        Sparse m_Sparse;
+        uint32_t* m_pRows; // a face of rows to hand the sparse cells over in
+        const int m_Words;
+        const int m_MaxSparseBlocks;
+        const int m_Total; // blocks of all faces
+        uint64_t m_Generation = 0;
+        int m_Handoffs = 0;
+        bool m_IsSparse = false;
+        bool m_Changed = false;
+    };
+
+}
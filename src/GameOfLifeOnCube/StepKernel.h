@@ -0,0 +1,386 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// The kernels have to be inlined into the vector width specific instances below.
+#define GOL3D_INLINE inline __attribute__((always_inline))
+
+namespace Gol3d {
+
+    enum class StepKernel : uint8_t
+    {
+        Auto,     // the widest one the CPU supports
+        Portable, // one uint32_t at a time
+        LookupTable, // 2 x 2 cells a table load, no bit arithmetic (for cores without SIMD, cf. BenchmarkStepKernels())
+        Sse2,
+        Avx2,
+        Avx512,
+    };
+
+namespace detail {
+
+    // Evaluates the rule for a word of cells whose neighbor counts are held in bit planes (s0 = 1 ... s3 = 8).
+    // Rule is known at compile time, so counts that neither give birth nor survive vanish from the expression.
+    template <uint32_t Rule, typename Word, int Count = 0>
+    struct RuleKernel
+    {
+        static GOL3D_INLINE Word Apply(const Word& row, const Word& s0, const Word& s1, const Word& s2, const Word& s3) noexcept
+        {
+            const bool birth = ((Rule >> Count) & 1) != 0;
+            const bool survival = ((Rule >> (16 + Count)) & 1) != 0;
+            const Word match = !birth && !survival ? Word() :
+                ((Count & 1) ? s0 : ~s0) & ((Count & 2) ? s1 : ~s1) & ((Count & 4) ? s2 : ~s2) & ((Count & 8) ? s3 : ~s3);
+            const Word alive = birth && survival ? match :
+                               birth ? match & ~row :
+                               survival ? match & row : Word();
+            return alive | RuleKernel<Rule, Word, Count + 1>::Apply(row, s0, s1, s2, s3);
+        }
+    };
+
+    template <uint32_t Rule, typename Word>
+    struct RuleKernel<Rule, Word, 9>
+    {
+        static GOL3D_INLINE Word Apply(const Word&, const Word&, const Word&, const Word&, const Word&) noexcept
+        {
+            return Word();
+        }
+    };
+
+    template <typename Word>
+    GOL3D_INLINE Word Load(const uint32_t* p) noexcept
+    {
+        Word word;
+        std::memcpy(&word, p, sizeof(Word));
+        return word;
+    }
+
+    template <typename Word>
+    GOL3D_INLINE void Store(uint32_t* p, const Word& word) noexcept
+    {
+        std::memcpy(p, &word, sizeof(Word));
+    }
+
+    template <typename Word>
+    GOL3D_INLINE uint32_t GetLane(const Word& word, int lane) noexcept
+    {
+        return word[lane];
+    }
+
+    template <>
+    GOL3D_INLINE uint32_t GetLane<uint32_t>(const uint32_t& word, int) noexcept
+    {
+        return word;
+    }
+
+    // the left neighbor of every cell in the words, bit 31 of the previous word is the one beyond bit 0
+    template <typename Word>
+    GOL3D_INLINE Word LeftNeighbors(const uint32_t* p) noexcept
+    {
+        return (Load<Word>(p) << 1) | (Load<Word>(p - 1) >> 31);
+    }
+
+    // the right neighbor of every cell in the words, bit 0 of the next word is the one beyond bit 31
+    template <typename Word>
+    GOL3D_INLINE Word RightNeighbors(const uint32_t* p) noexcept
+    {
+        return (Load<Word>(p) >> 1) | (Load<Word>(p + 1) << 31);
+    }
+
+    template <typename Word>
+    GOL3D_INLINE void HalfAdd(const Word& a, const Word& b, Word& sum, Word& carry) noexcept
+    {
+        sum = a ^ b;
+        carry = a & b;
+    }
+
+    template <typename Word>
+    GOL3D_INLINE void FullAdd(const Word& a, const Word& b, const Word& c, Word& sum, Word& carry) noexcept
+    {
+        const Word t = a ^ b;
+        sum = t ^ c;
+        carry = (a & b) | (t & c);
+    }
+
+    // the next generation of the words at pRow, pAbove and pBelow are the same columns one row up and down
+    template <uint32_t Rule, typename Word>
+    GOL3D_INLINE Word NextWord(const uint32_t* pAbove, const uint32_t* pRow, const uint32_t* pBelow) noexcept
+    {
+        // Counts the neighbors of all cells of the words at once.
+        // The count of each cell is held vertically in bit planes (s0 = 1, s1 = 2, s2 = 4, s3 = 8).
+        Word aboveSum, aboveCarry, belowSum, belowCarry, rowSum, rowCarry;
+        FullAdd(LeftNeighbors<Word>(pAbove), Load<Word>(pAbove), RightNeighbors<Word>(pAbove), aboveSum, aboveCarry);
+        FullAdd(LeftNeighbors<Word>(pBelow), Load<Word>(pBelow), RightNeighbors<Word>(pBelow), belowSum, belowCarry);
+        HalfAdd(LeftNeighbors<Word>(pRow), RightNeighbors<Word>(pRow), rowSum, rowCarry);
+
+        Word s0, c0, t, c1, s1, c2, s2, s3;
+        FullAdd(aboveSum, belowSum, rowSum, s0, c0);
+        FullAdd(aboveCarry, belowCarry, rowCarry, t, c1);
+        HalfAdd(t, c0, s1, c2);
+        HalfAdd(c1, c2, s2, s3);
+
+        return RuleKernel<Rule, Word>::Apply(Load<Word>(pRow), s0, s1, s2, s3);
+    }
+
+    // cells born and died in the words stepped
+    struct StepCounts
+    {
+        uint32_t births;
+        uint32_t deaths;
+    };
+
+    // Counts the cells of the words that changed, words that did not are skipped without a popcount.
+    template <typename Word>
+    GOL3D_INLINE void CountChanges(const Word& current, const Word& next, const Word& diff, StepCounts& counts) noexcept
+    {
+        const int lanes = sizeof(Word) / sizeof(uint32_t);
+        for (int k = 0; k < lanes; k++)
+        {
+            const uint32_t changed = GetLane(diff, k);
+            if (changed != 0)
+            {
+                counts.births += __builtin_popcount(changed & GetLane(next, k));
+                counts.deaths += __builtin_popcount(changed & GetLane(current, k));
+            }
+        }
+    }
+
+    // Steps rows x count words starting at pCurrent into pNext (rows are stride words apart),
+    // sets bit column + k of pChanged when the word k changed in any of the rows, and adds the
+    // cells that were born or died to counts.
+    typedef void (*StepBandFunction)(const uint32_t* pCurrent, uint32_t* pNext, int stride, int rows, int count, uint32_t* pChanged, int column, StepCounts& counts);
+
+    template <uint32_t Rule, typename Word>
+    GOL3D_INLINE void StepBand(const uint32_t* pCurrent, uint32_t* pNext, int stride, int rows, int count, uint32_t* pChanged, int column, StepCounts& counts) noexcept
+    {
+        const int lanes = sizeof(Word) / sizeof(uint32_t);
+        int i = 0;
+        for (; i + lanes <= count; i += lanes)
+        {
+            Word changed = Word();
+            for (int r = 0; r < rows; r++)
+            {
+                const uint32_t* p = pCurrent + r * stride + i;
+                const Word current = Load<Word>(p);
+                const Word next = NextWord<Rule, Word>(p - stride, p, p + stride);
+                const Word diff = next ^ current;
+                CountChanges(current, next, diff, counts);
+                changed |= diff;
+                Store(pNext + r * stride + i, next);
+            }
+            for (int k = 0; k < lanes; k++)
+            {
+                if (GetLane(changed, k) != 0)
+                {
+                    pChanged[(column + i + k) >> 5] |= 1u << ((column + i + k) & 31);
+                }
+            }
+        }
+        for (; i < count; i++)
+        {
+            uint32_t changed = 0;
+            for (int r = 0; r < rows; r++)
+            {
+                const uint32_t* p = pCurrent + r * stride + i;
+                const uint32_t next = NextWord<Rule, uint32_t>(p - stride, p, p + stride);
+                const uint32_t diff = next ^ *p;
+                CountChanges(*p, next, diff, counts);
+                changed |= diff;
+                pNext[r * stride + i] = next;
+            }
+            if (changed != 0)
+            {
+                pChanged[(column + i) >> 5] |= 1u << ((column + i) & 31);
+            }
+        }
+    }
+
+    template <uint32_t Rule>
+    void StepBandPortable(const uint32_t* pCurrent, uint32_t* pNext, int stride, int rows, int count, uint32_t* pChanged, int column, StepCounts& counts) noexcept
+    {
+        StepBand<Rule, uint32_t>(pCurrent, pNext, stride, rows, count, pChanged, column, counts);
+    }
+
+    // The next generation of 2 x 2 cells from the 4 x 4 cells around them, a nibble for each of the 65536 windows
+    // (32 KiB). Bits 4k .. 4k + 3 of a window are the columns -1 .. 2 of the row k - 1, bits 0, 1 of its nibble
+    // are the columns 0, 1 of the row 0 and bits 2, 3 those of the row 1.
+    template <uint32_t Rule>
+    class LookupTable
+    {
+    public:
+        // built on the first call (GetStepBandFunction() makes it, not the step)
+        static const LookupTable& Get() noexcept
+        {
+            static const LookupTable s_Table;
+            return s_Table;
+        }
+
+        GOL3D_INLINE uint32_t operator[](uint32_t window) const noexcept
+        {
+            return (m_Entries[window >> 1] >> ((window & 1) << 2)) & 0xF;
+        }
+
+    private:
+        LookupTable() noexcept
+        {
+            std::memset(m_Entries, 0, sizeof(m_Entries));
+            for (uint32_t window = 0; window < (1u << 16); window++)
+            {
+                uint32_t entry = 0;
+                for (int k = 0; k < 4; k++)
+                {
+                    const int x = 1 + (k & 1);
+                    const int y = 1 + (k >> 1);
+                    int count = 0;
+                    for (int dy = -1; dy <= 1; dy++)
+                    {
+                        for (int dx = -1; dx <= 1; dx++)
+                        {
+                            count += (dx != 0 || dy != 0) ? (window >> ((y + dy) * 4 + x + dx)) & 1 : 0;
+                        }
+                    }
+                    const bool alive = ((window >> (y * 4 + x)) & 1) != 0;
+                    entry |= ((Rule >> (alive ? 16 + count : count)) & 1) << k;
+                }
+                m_Entries[window >> 1] |= static_cast<uint8_t>(entry << ((window & 1) << 2));
+            }
+        }
+
+        uint8_t m_Entries[(1 << 16) / 2];
+    };
+
+    // the columns x - 1 .. x + 2 of the word at p, x is even
+    GOL3D_INLINE uint32_t GetWindowRow(const uint32_t* p, int x) noexcept
+    {
+        return x < 30 ? ((p[0] << 1 | p[-1] >> 31) >> x) & 0xF : (p[0] >> 29) | ((p[1] & 1) << 3);
+    }
+
+    // StepBand() a pair of rows at a time through LookupTable, the last row of an odd band alone
+    template <uint32_t Rule>
+    void StepBandLookupTable(const uint32_t* pCurrent, uint32_t* pNext, int stride, int rows, int count, uint32_t* pChanged, int column, StepCounts& counts) noexcept
+    {
+        const LookupTable<Rule>& table = LookupTable<Rule>::Get();
+        for (int i = 0; i < count; i++)
+        {
+            uint32_t changed = 0;
+            for (int r = 0; r < rows; r += 2)
+            {
+                const uint32_t* p = pCurrent + r * stride + i;
+                const bool pair = r + 1 < rows;
+                uint32_t next0 = 0;
+                uint32_t next1 = 0;
+                for (int x = 0; x < 32; x += 2)
+                {
+                    const uint32_t window = GetWindowRow(p - stride, x) | GetWindowRow(p, x) << 4 | GetWindowRow(p + stride, x) << 8 |
+                                            (pair ? GetWindowRow(p + 2 * stride, x) << 12 : 0);
+                    const uint32_t entry = table[window];
+                    next0 |= (entry & 3) << x;
+                    next1 |= (entry >> 2) << x;
+                }
+                const uint32_t diff0 = next0 ^ p[0];
+                CountChanges(p[0], next0, diff0, counts);
+                changed |= diff0;
+                pNext[r * stride + i] = next0;
+                if (pair)
+                {
+                    const uint32_t diff1 = next1 ^ p[stride];
+                    CountChanges(p[stride], next1, diff1, counts);
+                    changed |= diff1;
+                    pNext[(r + 1) * stride + i] = next1;
+                }
+            }
+            if (changed != 0)
+            {
+                pChanged[(column + i) >> 5] |= 1u << ((column + i) & 31);
+            }
+        }
+    }
+
+#if defined(__x86_64__)
+
+    typedef uint32_t Vector128 __attribute__((vector_size(16)));
+    typedef uint32_t Vector256 __attribute__((vector_size(32)));
+    typedef uint32_t Vector512 __attribute__((vector_size(64)));
+
+    template <uint32_t Rule>
+    void StepBandSse2(const uint32_t* pCurrent, uint32_t* pNext, int stride, int rows, int count, uint32_t* pChanged, int column, StepCounts& counts) noexcept
+    {
+        StepBand<Rule, Vector128>(pCurrent, pNext, stride, rows, count, pChanged, column, counts);
+    }
+
+    template <uint32_t Rule>
+    __attribute__((target("avx2,popcnt")))
+    void StepBandAvx2(const uint32_t* pCurrent, uint32_t* pNext, int stride, int rows, int count, uint32_t* pChanged, int column, StepCounts& counts) noexcept
+    {
+        StepBand<Rule, Vector256>(pCurrent, pNext, stride, rows, count, pChanged, column, counts);
+    }
+
+    template <uint32_t Rule>
+    __attribute__((target("avx512f,popcnt")))
+    void StepBandAvx512(const uint32_t* pCurrent, uint32_t* pNext, int stride, int rows, int count, uint32_t* pChanged, int column, StepCounts& counts) noexcept
+    {
+        StepBand<Rule, Vector512>(pCurrent, pNext, stride, rows, count, pChanged, column, counts);
+    }
+
+    inline bool IsSupported(StepKernel kernel) noexcept
+    {
+        __builtin_cpu_init();
+        switch (kernel)
+        {
+            case StepKernel::Avx512:
+                return __builtin_cpu_supports("avx512f");
+            case StepKernel::Avx2:
+                return __builtin_cpu_supports("avx2");
+            default:
+                return true;
+        }
+    }
+
+    // nullptr when the CPU lacks the instructions
+    template <uint32_t Rule>
+    StepBandFunction GetStepBandFunction(StepKernel kernel) noexcept
+    {
+        switch (kernel)
+        {
+            case StepKernel::Auto:
+                return IsSupported(StepKernel::Avx512) ? StepBandAvx512<Rule> :
+                       IsSupported(StepKernel::Avx2) ? StepBandAvx2<Rule> : StepBandSse2<Rule>;
+            case StepKernel::Portable:
+                return StepBandPortable<Rule>;
+            case StepKernel::LookupTable:
+                LookupTable<Rule>::Get();
+                return StepBandLookupTable<Rule>;
+            case StepKernel::Sse2:
+                return StepBandSse2<Rule>;
+            case StepKernel::Avx2:
+                return IsSupported(kernel) ? StepBandAvx2<Rule> : nullptr;
+            case StepKernel::Avx512:
+                return IsSupported(kernel) ? StepBandAvx512<Rule> : nullptr;
+            default:
+                return nullptr;
+        }
+    }
+
+#else
+
+    template <uint32_t Rule>
+    StepBandFunction GetStepBandFunction(StepKernel kernel) noexcept
+    {
+        switch (kernel)
+        {
+            case StepKernel::Auto:
+            case StepKernel::Portable:
+                return StepBandPortable<Rule>;
+            case StepKernel::LookupTable:
+                LookupTable<Rule>::Get();
+                return StepBandLookupTable<Rule>;
+            default:
+                return nullptr;
+        }
+    }
+
+#endif
+
+}
+
+}
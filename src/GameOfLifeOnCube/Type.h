@@ -23,6 +23,44 @@ struct Rect
     int height;
 };
 
+// bit x % 32 of pRows[y * stride + x / 32] is the cell (x, y)
+struct Bitmap
+{
+    const uint32_t* pRows;
+    int stride;
+    int width;
+    int height;
+};
+
+namespace detail {
+
+    // words of a row of bits cells in a Bitmap
+    constexpr int GetWordCount(int bits)
+    {
+        return (bits + 31) / 32;
+    }
+
+}
+
+static const int GameOfLifeDimension = 6;
+
+// bit p of the state of the cell (x, y) is the cell (x, y) of planes[p], states - 1 is the last state
+struct StateBitmap
+{
+    Bitmap planes[4];
+    int planeCount;
+    int states;
+};
+
+// cells of a face in a generation, and the ones that changed from the generation before
+struct FaceStatistics
+{
+    uint32_t live;
+    uint32_t births;
+    uint32_t deaths;
+    uint32_t changed; // births + deaths
+};
+
 enum class InputFlag : uint8_t
 {
     None = 0,
@@ -31,6 +69,12 @@ enum class InputFlag : uint8_t
     Cancel = 1 << 2,
 };
 
+enum class Topology : uint8_t
+{
+    Torus,    // every face wraps onto itself
+    Stitched, // faces are joined along the cube edges
+};
+
 struct Vector3d
 {
     float x;
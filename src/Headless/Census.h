@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace Gol3d {
+
+    static const int MaxCodeLength = 128;
+
+    // Objects found by the soup search and how often, named the way apgsearch names them:
+    // xs<cells>_ still lifes, xp<period>_ oscillators, xq<period>_ spaceships, each followed by
+    // the extended Wechsler format of its smallest phase and orientation (xs4_33 block, xp2_7 blinker, xq4_153 glider).
+    // The table has a fixed capacity, objects that do not fit any more are counted as overflow.
+    class Census
+    {
+    public:
+        static const int Capacity = 1 << 14;
+
+        struct Entry
+        {
+            char code[MaxCodeLength];
+            uint64_t count;
+            long seed;  // the smallest seed of a soup the object was found in
+            int faces;  // the most faces the object was seen on
+        };
+
+        Census() noexcept
+        {
+            Clear();
+        }
+
+        void Clear() noexcept
+        {
+            std::memset(m_Entries, 0, sizeof(m_Entries));
+            m_Size = 0;
+            m_Overflow = 0;
+        }
+
+        void Add(const char* code, long seed, int faces, uint64_t count = 1) noexcept
+        {
+            Entry* pEntry = Find(code);
+            if (pEntry == nullptr)
+            {
+                m_Overflow += count;
+                return;
+            }
+            if (pEntry->count == 0)
+            {
+                // the slot is zeroed, codes longer than a slot are cut
+                const size_t length = std::strlen(code);
+                std::memcpy(pEntry->code, code, length < MaxCodeLength ? length : MaxCodeLength - 1);
+                pEntry->seed = seed;
+                m_Size++;
+            }
+            pEntry->count += count;
+            pEntry->seed = seed < pEntry->seed ? seed : pEntry->seed;
+            pEntry->faces = faces > pEntry->faces ? faces : pEntry->faces;
+        }
+
+        void Merge(const Census& census) noexcept
+        {
+            for (const Entry& entry : census.m_Entries)
+            {
+                if (entry.count != 0)
+                {
+                    Add(entry.code, entry.seed, entry.faces, entry.count);
+                }
+            }
+            m_Overflow += census.m_Overflow;
+        }
+
+        // the slots of the table, unused ones have a count of 0
+        const Entry* GetEntries() const noexcept
+        {
+            return m_Entries;
+        }
+
+        int GetSize() const noexcept
+        {
+            return m_Size;
+        }
+
+        uint64_t GetOverflow() const noexcept
+        {
+            return m_Overflow;
+        }
+
+    private:
+        // the slot of the code, or the empty one it goes to, nullptr when the table is full
+        Entry* Find(const char* code) noexcept
+        {
+            uint32_t hash = 2166136261u;
+            for (const char* p = code; *p != '\0'; p++)
+            {
+                hash = (hash ^ static_cast<uint8_t>(*p)) * 16777619u;
+            }
+            for (int i = 0; i < Capacity; i++)
+            {
+                Entry& entry = m_Entries[(hash + i) & (Capacity - 1)];
+                if (entry.count == 0 || std::strcmp(entry.code, code) == 0)
+                {
+                    return &entry;
+                }
+            }
+            return nullptr;
+        }
+
+        Entry m_Entries[Capacity];
+        int m_Size;
+        uint64_t m_Overflow;
+    };
+
+namespace detail {
+
+    struct Point
+    {
+        int x;
+        int y;
+    };
+
+    // Writes the extended Wechsler format of points (inside width x height) seen in one of the
+    // 8 orientations to pCode. Returns its length, -1 when it does not fit.
+    //
+    // The rows are cut into strips of 5, every column of a strip is a character 0 .. v (bit n is row n),
+    // strips are separated by z, runs of empty columns are 0, w (2), x (3) or y followed by 0 .. z (4 .. 39)
+    // and are left out at the end of a strip.
+    template <int MaxSpan>
+    int EncodeWechsler(const Point* pPoints, int count, int width, int height, int orientation, char* pCode, int capacity) noexcept
+    {
+        static const char Digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+        const bool transposed = (orientation & 4) != 0;
+        const int w = transposed ? height : width;
+        const int h = transposed ? width : height;
+        const int strips = (h + 4) / 5;
+
+        uint8_t columns[(MaxSpan + 4) / 5][MaxSpan];
+        for (int s = 0; s < strips; s++)
+        {
+            std::memset(columns[s], 0, w);
+        }
+        for (int i = 0; i < count; i++)
+        {
+            int x = (orientation & 1) != 0 ? width - 1 - pPoints[i].x : pPoints[i].x;
+            int y = (orientation & 2) != 0 ? height - 1 - pPoints[i].y : pPoints[i].y;
+            if (transposed)
+            {
+                const int t = x;
+                x = y;
+                y = t;
+            }
+            columns[y / 5][x] |= 1 << (y % 5);
+        }
+
+        int length = 0;
+        for (int s = 0; s < strips; s++)
+        {
+            if (s != 0)
+            {
+                if (length + 1 >= capacity)
+                {
+                    return -1;
+                }
+                pCode[length++] = 'z';
+            }
+            int zeros = 0;
+            for (int x = 0; x < w; x++)
+            {
+                if (columns[s][x] == 0)
+                {
+                    zeros++;
+                    continue;
+                }
+                // at most 2 characters for a run of zeros plus the column
+                if (length + 2 * (zeros / 40 + 1) + 1 >= capacity)
+                {
+                    return -1;
+                }
+                for (; zeros >= 40; zeros -= 39)
+                {
+                    pCode[length++] = 'y';
+                    pCode[length++] = 'z';
+                }
+                if (zeros >= 4)
+                {
+                    pCode[length++] = 'y';
+                    pCode[length++] = Digits[zeros - 4];
+                }
+                else if (zeros > 0)
+                {
+                    pCode[length++] = "0wx"[zeros - 1];
+                }
+                zeros = 0;
+                pCode[length++] = Digits[columns[s][x]];
+            }
+        }
+        pCode[length] = '\0';
+        return length;
+    }
+
+    // the shorter code comes first, then the alphabetically smaller one
+    inline bool IsBetterCode(const char* pCode, int length, const char* pBest, int bestLength) noexcept
+    {
+        return bestLength < 0 || length < bestLength || (length == bestLength && std::strcmp(pCode, pBest) < 0);
+    }
+
+}
+
+}
@@ -0,0 +1,865 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include "../GameOfLifeOnCube/Blend.h"
+#include "../GameOfLifeOnCube/Ensemble.h"
+#include "../GameOfLifeOnCube/GameOfLife.h"
+#include "../GameOfLifeOnCube/Generations.h"
+#include "../GameOfLifeOnCube/HashLife.h"
+#include "../GameOfLifeOnCube/History.h"
+#include "../GameOfLifeOnCube/LargerThanLife.h"
+#include "../GameOfLifeOnCube/SparseLife.h"
+
+namespace Gol3d {
+
+namespace detail {
+
+    // A face of rows as CopyCurrent() writes them, and arenas for the engines, allocated by the checks only.
+    struct FaceRows
+    {
+        FaceRows(int col, int row) noexcept
+        : words(GetWordCount(col))
+        , col(col)
+        , row(row)
+        , pRows(new uint32_t[row * GetWordCount(col)]())
+        {
+        }
+
+        Bitmap GetBitmap() const noexcept
+        {
+            return { pRows.get(), words, col, row };
+        }
+
+        void Clear() noexcept
+        {
+            std::memset(pRows.get(), 0, sizeof(uint32_t) * row * words);
+        }
+
+        void Set(int x, int y) noexcept
+        {
+            pRows[y * words + (x >> 5)] |= 1u << (x & 31);
+        }
+
+        const int words;
+        const int col;
+        const int row;
+        std::unique_ptr<uint32_t[]> pRows;
+    };
+
+    inline std::unique_ptr<uint64_t[]> MakeArena(size_t size) noexcept
+    {
+        return std::unique_ptr<uint64_t[]>(new uint64_t[size / sizeof(uint64_t) + 1]);
+    }
+
+    // Prints the first cell of a face that differs from the expected one, false when there is one.
+    inline bool IsSameFace(const char* name, uint64_t generation, int d, const Bitmap& expected, const Bitmap& actual) noexcept
+    {
+        for (int y = 0; y < expected.height; y++)
+        {
+            for (int x = 0; x < expected.width; x++)
+            {
+                const bool e = ((expected.pRows[y * expected.stride + (x >> 5)] >> (x & 31)) & 1) != 0;
+                const bool a = ((actual.pRows[y * actual.stride + (x >> 5)] >> (x & 31)) & 1) != 0;
+                if (e != a)
+                {
+                    std::printf("%s: generation %llu, face %d, cell (%d, %d) is %d instead of %d\n",
+                                name, static_cast<unsigned long long>(generation), d, x, y, a, e);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // every face of an engine with GetCurrent() against GameOfLifeImpl
+    template <typename Engine, uint32_t Rule>
+    bool IsSameCube(const char* name, const Engine& engine, const GameOfLifeImpl<Rule>& reference) noexcept
+    {
+        if (engine.GetGeneration() != reference.GetGeneration())
+        {
+            std::printf("%s: generation %llu instead of %llu\n", name,
+                        static_cast<unsigned long long>(engine.GetGeneration()), static_cast<unsigned long long>(reference.GetGeneration()));
+            return false;
+        }
+        for (int d = 0; d < GameOfLifeDimension; d++)
+        {
+            if (!IsSameFace(name, reference.GetGeneration(), d, reference.GetCurrent(d), engine.GetCurrent(d)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Six faces of col x row cells a byte each (the state), stepped cell by cell with LocateCell() for every
+    // neighbor: slow and obvious, the reference for the bit-parallel engines and their halos.
+    class NaiveCube
+    {
+    public:
+        NaiveCube(int col, int row, Topology topology) noexcept
+        : m_Col(col)
+        , m_Row(row)
+        , m_Topology(topology)
+        , m_pCells(new uint8_t[GameOfLifeDimension * col * row]())
+        , m_pNext(new uint8_t[GameOfLifeDimension * col * row]())
+        {
+        }
+
+        // state 1 for the cells of the bitmap that are set, 0 for the others
+        void SetCurrent(int d, const Bitmap& bitmap) noexcept
+        {
+            for (int y = 0; y < m_Row; y++)
+            {
+                for (int x = 0; x < m_Col; x++)
+                {
+                    m_pCells[GetIndex(d, x, y)] = (bitmap.pRows[y * bitmap.stride + (x >> 5)] >> (x & 31)) & 1;
+                }
+            }
+        }
+
+        // Steps every cell to next(state, live), live being the cells in state 1 of the (2 radius + 1)^2 box
+        // around it, itself left out.
+        template <typename Rule>
+        void Next(int radius, Rule next) noexcept
+        {
+            for (int d = 0; d < GameOfLifeDimension; d++)
+            {
+                FaceStatistics& statistics = m_Statistics[d];
+                statistics = { 0, 0, 0, 0 };
+                for (int y = 0; y < m_Row; y++)
+                {
+                    for (int x = 0; x < m_Col; x++)
+                    {
+                        int live = 0;
+                        for (int dy = -radius; dy <= radius; dy++)
+                        {
+                            for (int dx = -radius; dx <= radius; dx++)
+                            {
+                                live += (dx != 0 || dy != 0) && GetCell(d, x + dx, y + dy) == 1;
+                            }
+                        }
+                        const uint8_t state = m_pCells[GetIndex(d, x, y)];
+                        const uint8_t after = static_cast<uint8_t>(next(state, live));
+                        m_pNext[GetIndex(d, x, y)] = after;
+                        statistics.live += after == 1;
+                        statistics.births += state != 1 && after == 1;
+                        statistics.deaths += state == 1 && after != 1;
+                    }
+                }
+                statistics.changed = statistics.births + statistics.deaths;
+            }
+            m_pCells.swap(m_pNext);
+        }
+
+        // cells in state 1, born and died in the last Next()
+        const FaceStatistics& GetStatistics(int d) const noexcept
+        {
+            return m_Statistics[d];
+        }
+
+        // bit plane of the states of the face d, plane 0 of two states is the live cells
+        void CopyPlane(int d, int plane, FaceRows& rows) const noexcept
+        {
+            rows.Clear();
+            for (int y = 0; y < m_Row; y++)
+            {
+                for (int x = 0; x < m_Col; x++)
+                {
+                    if (((m_pCells[GetIndex(d, x, y)] >> plane) & 1) != 0)
+                    {
+                        rows.Set(x, y);
+                    }
+                }
+            }
+        }
+
+        // the cells of the face d in the state
+        void CopyState(int d, int state, FaceRows& rows) const noexcept
+        {
+            rows.Clear();
+            for (int y = 0; y < m_Row; y++)
+            {
+                for (int x = 0; x < m_Col; x++)
+                {
+                    if (m_pCells[GetIndex(d, x, y)] == state)
+                    {
+                        rows.Set(x, y);
+                    }
+                }
+            }
+        }
+
+    private:
+        int GetIndex(int d, int x, int y) const noexcept
+        {
+            return (d * m_Row + y) * m_Col + x;
+        }
+
+        // the state of a cell up to a face beyond the edges, 0 past a stitched corner
+        uint8_t GetCell(int d, int x, int y) const noexcept
+        {
+            return LocateCell(m_Topology, m_Col, m_Row, d, x, y) ? m_pCells[GetIndex(d, x, y)] : 0;
+        }
+
+        const int m_Col;
+        const int m_Row;
+        const Topology m_Topology;
+        std::unique_ptr<uint8_t[]> m_pCells;
+        std::unique_ptr<uint8_t[]> m_pNext;
+        FaceStatistics m_Statistics[GameOfLifeDimension] = {};
+    };
+
+    // B/S rule of the eight neighbors as ParseRule() packs it
+    template <uint32_t Rule>
+    int NextConway(int state, int live) noexcept
+    {
+        return (Rule >> (state == 1 ? 16 + live : live)) & 1;
+    }
+
+    // a Larger than Life rule, the cell itself counts when the rule says so
+    template <uint64_t Rule>
+    int NextLargerThanLife(int state, int live) noexcept
+    {
+        typedef LargerThanLifeImpl<Rule> Life;
+        const int count = live + (Life::Middle && state == 1);
+        return state == 1 ? count >= Life::SurvivalMin && count <= Life::SurvivalMax : count >= Life::BirthMin && count <= Life::BirthMax;
+    }
+
+    // the same for a Generations rule, a live cell that does not survive decays through the states after 1
+    template <uint32_t Rule, int States>
+    int NextGenerations(int state, int live) noexcept
+    {
+        return state == 0 ? (Rule >> live) & 1 :
+               state == 1 ? (((Rule >> (16 + live)) & 1) != 0 ? 1 : 2 % States) :
+               (state + 1) % States;
+    }
+
+    inline bool IsSameStatistics(const char* name, uint64_t generation, int d, const FaceStatistics& expected, const FaceStatistics& actual) noexcept
+    {
+        if (std::memcmp(&expected, &actual, sizeof(FaceStatistics)) == 0)
+        {
+            return true;
+        }
+        std::printf("%s: generation %llu, face %d counts %u live, %u births, %u deaths instead of %u, %u, %u\n", name,
+                    static_cast<unsigned long long>(generation), d, actual.live, actual.births, actual.deaths, expected.live, expected.births, expected.deaths);
+        return false;
+    }
+
+    // Steps an engine with CopyCurrent() in lockstep with GameOfLifeImpl for the given generations.
+    template <typename Engine, uint32_t Rule>
+    bool IsLockstep(const char* name, Engine& engine, GameOfLifeImpl<Rule>& reference, FaceRows& rows, int generations) noexcept
+    {
+        for (int g = 0; g <= generations; g++)
+        {
+            for (int d = 0; d < GameOfLifeDimension; d++)
+            {
+                engine.CopyCurrent(d, rows.pRows.get(), rows.words);
+                if (!IsSameFace(name, reference.GetGeneration(), d, reference.GetCurrent(d), rows.GetBitmap()))
+                {
+                    return false;
+                }
+            }
+            if (g < generations)
+            {
+                engine.Next();
+                reference.Next();
+            }
+        }
+        return true;
+    }
+
+}
+
+    // Every step kernel the CPU runs (GameOfLifeImpl::SetStepKernel()) against NaiveCube, cells and statistics
+    // every generation: torus faces wide enough for the widest vectors with a partial last word and a last band
+    // of one row, and stitched ones, one of them with a last band of three rows (LookupTable steps pairs of rows).
+    inline bool CheckStepKernels() noexcept
+    {
+        typedef GameOfLifeImpl<ConwayRule> Dense;
+
+        struct Kernel
+        {
+            StepKernel kernel;
+            const char* name;
+        };
+        const Kernel kernels[] = {
+            { StepKernel::Portable, "Portable" },
+            { StepKernel::LookupTable, "LookupTable" },
+            { StepKernel::Sse2, "Sse2" },
+            { StepKernel::Avx2, "Avx2" },
+            { StepKernel::Avx512, "Avx512" },
+        };
+        const int count = sizeof(kernels) / sizeof(kernels[0]);
+
+        struct Case
+        {
+            int col;
+            int row;
+            Topology topology;
+        };
+        const Case cases[] = { { 600, 37, Topology::Torus }, { 100, 100, Topology::Stitched }, { 64, 64, Topology::Stitched },
+                               { 47, 47, Topology::Stitched } };
+        for (const Case& c : cases)
+        {
+            std::unique_ptr<uint64_t[]> pArenas[count];
+            std::unique_ptr<Dense> pEngines[count];
+            for (int k = 0; k < count; k++)
+            {
+                pArenas[k] = detail::MakeArena(Dense::GetArenaSize(c.col, c.row));
+                pEngines[k].reset(new Dense(c.col, c.row, pArenas[k].get(), 5));
+                pEngines[k]->SetTopology(c.topology);
+                if (!pEngines[k]->SetStepKernel(kernels[k].kernel))
+                {
+                    pEngines[k].reset();
+                }
+            }
+
+            detail::NaiveCube naive(c.col, c.row, c.topology);
+            for (int d = 0; d < GameOfLifeDimension; d++)
+            {
+                naive.SetCurrent(d, pEngines[0]->GetCurrent(d));
+            }
+            detail::FaceRows rows(c.col, c.row);
+            for (int g = 1; g <= 120; g++)
+            {
+                naive.Next(1, detail::NextConway<ConwayRule>);
+                for (int k = 0; k < count; k++)
+                {
+                    if (pEngines[k] == nullptr)
+                    {
+                        continue;
+                    }
+                    pEngines[k]->Next();
+                    for (int d = 0; d < GameOfLifeDimension; d++)
+                    {
+                        naive.CopyPlane(d, 0, rows);
+                        if (!detail::IsSameFace(kernels[k].name, g, d, rows.GetBitmap(), pEngines[k]->GetCurrent(d)) ||
+                            !detail::IsSameStatistics(kernels[k].name, g, d, naive.GetStatistics(d), pEngines[k]->GetStatistics(d)))
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // GameOfLifeImpl stepped on a ThreadPool against the same soup stepped on the calling thread, cells and
+    // statistics every generation: torus faces of a Col that is no multiple of 32 and more than one task high,
+    // and stitched ones.
+    inline bool CheckParallel() noexcept
+    {
+        typedef GameOfLifeImpl<ConwayRule> Dense;
+
+        struct Case
+        {
+            int col;
+            int row;
+            Topology topology;
+        };
+        const Case cases[] = { { 200, 150, Topology::Torus }, { 100, 100, Topology::Stitched }, { 128, 128, Topology::Stitched } };
+        ThreadPool pool(4);
+        for (const Case& c : cases)
+        {
+            auto pSingleArena = detail::MakeArena(Dense::GetArenaSize(c.col, c.row));
+            auto pParallelArena = detail::MakeArena(Dense::GetArenaSize(c.col, c.row));
+            Dense single(c.col, c.row, pSingleArena.get(), 11);
+            Dense parallel(c.col, c.row, pParallelArena.get(), 11);
+            single.SetTopology(c.topology);
+            parallel.SetTopology(c.topology);
+            parallel.SetParallel(&pool);
+            for (int g = 0; g <= 300; g++)
+            {
+                if (!detail::IsSameCube("ThreadPool", parallel, single))
+                {
+                    return false;
+                }
+                for (int d = 0; d < GameOfLifeDimension; d++)
+                {
+                    if (!detail::IsSameStatistics("ThreadPool", single.GetGeneration(), d, single.GetStatistics(d), parallel.GetStatistics(d)))
+                    {
+                        return false;
+                    }
+                }
+                single.Next();
+                parallel.Next();
+            }
+        }
+        return true;
+    }
+
+    // SparseLifeImpl stepped in lockstep with GameOfLifeImpl from the same soup, faces of any size and both
+    // topologies, then AdaptiveLifeImpl handing a growing pattern over to GameOfLifeImpl and a small one back.
+    inline bool CheckSparseLife() noexcept
+    {
+        typedef GameOfLifeImpl<ConwayRule> Dense;
+        typedef SparseLifeImpl<ConwayRule> Sparse;
+        typedef AdaptiveLifeImpl<ConwayRule> Adaptive;
+
+        const int lengths[] = { 16, 40, 100 };
+        for (int length : lengths)
+        {
+            for (Topology topology : { Topology::Torus, Topology::Stitched })
+            {
+                // a block for every 32 x 32 cells of the faces, the soup may be anywhere
+                const int blocks = GameOfLifeDimension * ((length + 31) / 32) * ((length + 31) / 32);
+                auto pDenseArena = detail::MakeArena(Dense::GetArenaSize(length, length));
+                auto pSparseArena = detail::MakeArena(Sparse::GetArenaSize(blocks));
+                Dense dense(length, length, pDenseArena.get(), length);
+                Sparse sparse(length, length, blocks, pSparseArena.get());
+                dense.SetTopology(topology);
+                sparse.SetTopology(topology);
+                for (int d = 0; d < GameOfLifeDimension; d++)
+                {
+                    sparse.SetCurrent(d, dense.GetCurrent(d));
+                }
+                detail::FaceRows rows(length, length);
+                if (!detail::IsLockstep("SparseLifeImpl", sparse, dense, rows, 300) || sparse.HasOverflowed())
+                {
+                    return false;
+                }
+            }
+        }
+
+        // An R-pentomino starts sparse and outgrows the pool within 300 generations, a glider put in its place fits again.
+        const int length = 128;
+        const int capacity = 144;
+        auto pDenseArena = detail::MakeArena(Dense::GetArenaSize(length, length));
+        auto pAdaptiveArena = detail::MakeArena(Adaptive::GetArenaSize(length, length, capacity));
+        Dense dense(length, length, pDenseArena.get(), 0);
+        Adaptive adaptive(length, length, capacity, pAdaptiveArena.get(), 0);
+        dense.SetTopology(Topology::Stitched);
+        adaptive.SetTopology(Topology::Stitched);
+        detail::FaceRows rows(length, length);
+
+        const int rPentomino[][2] = { { 1, 0 }, { 2, 0 }, { 0, 1 }, { 1, 1 }, { 1, 2 } };
+        const int glider[][2] = { { 1, 0 }, { 2, 1 }, { 0, 2 }, { 1, 2 }, { 2, 2 } };
+        for (int phase = 0; phase < 2; phase++)
+        {
+            for (int d = 0; d < GameOfLifeDimension; d++)
+            {
+                rows.Clear();
+                for (int i = 0; i < 5 && d == 2 * phase; i++)
+                {
+                    const auto& cell = phase == 0 ? rPentomino[i] : glider[i];
+                    rows.Set(length / 2 + cell[0], length / 2 + cell[1]);
+                }
+                dense.SetCurrent(d, rows.GetBitmap());
+                adaptive.SetCurrent(d, rows.GetBitmap());
+            }
+            if (!detail::IsLockstep("AdaptiveLifeImpl", adaptive, dense, rows, 400))
+            {
+                return false;
+            }
+        }
+        if (adaptive.GetHandoffCount() != 3 || !adaptive.IsSparse())
+        {
+            std::printf("AdaptiveLifeImpl: %d handoffs instead of 3\n", adaptive.GetHandoffCount());
+            return false;
+        }
+        return true;
+    }
+
+    // HashLifeImpl jumping 2^k generations against as many GameOfLifeImpl::Next() on torus faces, with a node
+    // pool small enough to be collected on the way, and one too small for the longer jumps that leave the faces alone.
+    inline bool CheckHashLife() noexcept
+    {
+        typedef GameOfLifeImpl<ConwayRule> Dense;
+        typedef HashLifeImpl<ConwayRule> HashLife;
+
+        const int length = 64;
+        const int jumps[] = { 0, 1, 2, 3, 4, 5, 6, 7, 3, 0, 7 };
+        for (int capacity : { 1 << 14, 1 << 11 })
+        {
+            auto pDenseArena = detail::MakeArena(Dense::GetArenaSize(length, length));
+            auto pHashArena = detail::MakeArena(HashLife::GetArenaSize(length, capacity));
+            Dense dense(length, length, pDenseArena.get(), 7);
+            HashLife hashLife(length, capacity, pHashArena.get());
+            for (int d = 0; d < GameOfLifeDimension; d++)
+            {
+                hashLife.SetCurrent(d, dense.GetCurrent(d));
+            }
+
+            bool collected = false;
+            for (int k : jumps)
+            {
+                const int nodes = hashLife.GetNodeCount();
+                if (!hashLife.Jump(k))
+                {
+                    break;
+                }
+                collected = collected || hashLife.GetNodeCount() < nodes;
+                for (int g = 0; g < 1 << k; g++)
+                {
+                    dense.Next();
+                }
+                if (!detail::IsSameCube("HashLifeImpl", hashLife, dense))
+                {
+                    return false;
+                }
+            }
+            if (!detail::IsSameCube("HashLifeImpl", hashLife, dense))
+            {
+                return false;
+            }
+
+            // the larger pool makes every jump by collecting, the smaller one gives up on the way
+            const bool complete = hashLife.GetGeneration() == 392;
+            if (complete != (capacity == 1 << 14) || (complete && !collected))
+            {
+                std::printf("HashLifeImpl: %llu generations in %d nodes, %s\n", static_cast<unsigned long long>(hashLife.GetGeneration()),
+                            capacity, collected ? "collected" : "never collected");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Every universe of EnsembleImpl against GameOfLifeImpl(col, row, ..., seed + u), generation after generation.
+    template <typename Lane>
+    bool CheckEnsemble(int col, int row, Topology topology, long seed, int generations) noexcept
+    {
+        typedef GameOfLifeImpl<ConwayRule> Dense;
+        typedef EnsembleImpl<ConwayRule, Lane> Ensemble;
+
+        auto pEnsembleArena = detail::MakeArena(Ensemble::GetArenaSize(col, row));
+        Ensemble ensemble(col, row, pEnsembleArena.get(), seed);
+        ensemble.SetTopology(topology);
+        std::unique_ptr<uint64_t[]> pDenseArenas[Ensemble::Universes];
+        std::unique_ptr<Dense> pUniverses[Ensemble::Universes];
+        for (int u = 0; u < Ensemble::Universes; u++)
+        {
+            pDenseArenas[u] = detail::MakeArena(Dense::GetArenaSize(col, row));
+            pUniverses[u].reset(new Dense(col, row, pDenseArenas[u].get(), seed + u));
+            pUniverses[u]->SetTopology(topology);
+        }
+
+        detail::FaceRows rows(col, row);
+        for (int g = 0; g <= generations; g++)
+        {
+            for (int u = 0; u < Ensemble::Universes; u++)
+            {
+                for (int d = 0; d < GameOfLifeDimension; d++)
+                {
+                    ensemble.CopyCurrent(u, d, rows.pRows.get(), rows.words);
+                    if (!detail::IsSameFace("EnsembleImpl", ensemble.GetGeneration(), d, pUniverses[u]->GetCurrent(d), rows.GetBitmap()))
+                    {
+                        std::printf("EnsembleImpl: in universe %d of %d\n", u, Ensemble::Universes);
+                        return false;
+                    }
+                }
+                if (g < generations)
+                {
+                    pUniverses[u]->Next();
+                }
+            }
+            if (g < generations)
+            {
+                ensemble.Next();
+            }
+        }
+        return true;
+    }
+
+    // 64 and 32 universes, square stitched faces and oblong torus ones
+    inline bool CheckEnsemble() noexcept
+    {
+        return CheckEnsemble<uint64_t>(40, 40, Topology::Stitched, 100, 200) &&
+               CheckEnsemble<uint64_t>(48, 20, Topology::Torus, 200, 200) &&
+               CheckEnsemble<uint32_t>(17, 17, Topology::Stitched, 300, 200);
+    }
+
+    // GenerationsImpl against NaiveCube, every bit plane and the alive cells every generation.
+    template <uint32_t Rule, int States>
+    bool CheckGenerations(const char* name, int col, int row, Topology topology, int generations) noexcept
+    {
+        typedef GenerationsImpl<Rule, States> Generations;
+
+        auto pArena = detail::MakeArena(Generations::GetArenaSize(col, row));
+        Generations life(col, row, pArena.get(), 9);
+        life.SetTopology(topology);
+        detail::NaiveCube naive(col, row, topology);
+        for (int d = 0; d < GameOfLifeDimension; d++)
+        {
+            naive.SetCurrent(d, life.GetCurrent(d));
+        }
+
+        detail::FaceRows rows(col, row);
+        for (int g = 1; g <= generations; g++)
+        {
+            life.Next();
+            naive.Next(1, detail::NextGenerations<Rule, States>);
+            for (int d = 0; d < GameOfLifeDimension; d++)
+            {
+                const StateBitmap states = life.GetStates(d);
+                for (int p = 0; p < states.planeCount; p++)
+                {
+                    naive.CopyPlane(d, p, rows);
+                    if (!detail::IsSameFace(name, g, d, rows.GetBitmap(), states.planes[p]))
+                    {
+                        std::printf("%s: in plane %d\n", name, p);
+                        return false;
+                    }
+                }
+                naive.CopyState(d, 1, rows);
+                if (!detail::IsSameFace(name, g, d, rows.GetBitmap(), life.GetCurrent(d)))
+                {
+                    std::printf("%s: in the alive cells\n", name);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Brian's Brain (3 states in 2 planes) and Star Wars (4 states), both topologies
+    inline bool CheckGenerations() noexcept
+    {
+        return CheckGenerations<BriansBrainRule, 3>("BriansBrain", 70, 39, Topology::Torus, 150) &&
+               CheckGenerations<BriansBrainRule, 3>("BriansBrain", 48, 48, Topology::Stitched, 150) &&
+               CheckGenerations<StarWarsRule, 4>("StarWars", 70, 39, Topology::Torus, 150) &&
+               CheckGenerations<StarWarsRule, 4>("StarWars", 48, 48, Topology::Stitched, 150);
+    }
+
+    // LargerThanLifeImpl of LargerConwayRule in lockstep with GameOfLifeImpl, then a rule of the largest radius
+    // against NaiveCube counting its boxes cell by cell, on both topologies: the sliding sums and halos Radius deep.
+    inline bool CheckLargerThanLife() noexcept
+    {
+        typedef GameOfLifeImpl<ConwayRule> Dense;
+        typedef LargerThanLifeImpl<LargerConwayRule> LargerConway;
+        // grows for some 20 generations from a dense soup on either topology
+        constexpr uint64_t Radius10Rule = LargerThanLifeRule(10, 150, 300, 200, 210);
+        typedef LargerThanLifeImpl<Radius10Rule> Radius10;
+
+        for (Topology topology : { Topology::Torus, Topology::Stitched })
+        {
+            const int length = 70;
+            auto pDenseArena = detail::MakeArena(Dense::GetArenaSize(length, length));
+            auto pLargerArena = detail::MakeArena(LargerConway::GetArenaSize(length, length));
+            Dense dense(length, length, pDenseArena.get(), 13);
+            LargerConway larger(length, length, pLargerArena.get(), 0);
+            dense.SetTopology(topology);
+            larger.SetTopology(topology);
+            for (int d = 0; d < GameOfLifeDimension; d++)
+            {
+                larger.SetCurrent(d, dense.GetCurrent(d));
+            }
+            for (int g = 0; g <= 200; g++)
+            {
+                if (!detail::IsSameCube("LargerConwayRule", larger, dense))
+                {
+                    return false;
+                }
+                larger.Next();
+                dense.Next();
+            }
+        }
+
+        for (Topology topology : { Topology::Torus, Topology::Stitched })
+        {
+            const int length = 40;
+            auto pArena = detail::MakeArena(Radius10::GetArenaSize(length, length));
+            Radius10 life(length, length, pArena.get(), 17);
+            life.SetTopology(topology);
+            life.SetDensity(DensityFromPercent(50));
+            life.SetState(2);
+            life.Next();
+            detail::NaiveCube naive(length, length, topology);
+            for (int d = 0; d < GameOfLifeDimension; d++)
+            {
+                naive.SetCurrent(d, life.GetCurrent(d));
+            }
+
+            detail::FaceRows rows(length, length);
+            for (int g = 1; g <= 30; g++)
+            {
+                life.Next();
+                naive.Next(Radius10::Radius, detail::NextLargerThanLife<Radius10Rule>);
+                for (int d = 0; d < GameOfLifeDimension; d++)
+                {
+                    naive.CopyPlane(d, 0, rows);
+                    if (!detail::IsSameFace("LargerThanLifeImpl", g, d, rows.GetBitmap(), life.GetCurrent(d)))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // GameOfLifeImpl keeping a History of 48 generations, keyframes every 8, in a buffer large enough for all of them
+    // and in one that holds a few keyframes only. Every generation the history can rebuild is checked against the
+    // ones of a GameOfLifeImpl without history, then the engine rewinds and steps on to the same generations.
+    inline bool CheckHistory() noexcept
+    {
+        typedef GameOfLifeImpl<ConwayRule> Dense;
+
+        const int length = 40;
+        const int capacity = 48;
+        const int keyframeInterval = 8;
+        const int generations = 200;
+        const int words = detail::GetWordCount(length);
+        const int frameWords = GameOfLifeDimension * length * words;
+
+        // every generation of the reference, face after face
+        auto pReferenceArena = detail::MakeArena(Dense::GetArenaSize(length, length));
+        Dense reference(length, length, pReferenceArena.get(), 3);
+        reference.SetTopology(Topology::Stitched);
+        std::unique_ptr<uint32_t[]> pFrames(new uint32_t[(generations + 1) * frameWords]);
+        for (int g = 0; g <= generations; g++)
+        {
+            for (int d = 0; d < GameOfLifeDimension; d++)
+            {
+                const Bitmap face = reference.GetCurrent(d);
+                for (int y = 0; y < length; y++)
+                {
+                    std::memcpy(&pFrames[g * frameWords + (d * length + y) * words], face.pRows + y * face.stride, sizeof(uint32_t) * words);
+                }
+            }
+            reference.Next();
+        }
+        auto getFrame = [&](uint64_t g, int d) -> Bitmap {
+            return { &pFrames[g * frameWords + d * length * words], words, length, length };
+        };
+
+        const size_t minimum = History::GetMinimumSize(length, length, capacity);
+        for (size_t bytes : { minimum + sizeof(uint32_t) * capacity * frameWords, minimum + sizeof(uint32_t) * 3 * frameWords })
+        {
+            auto pArena = detail::MakeArena(Dense::GetArenaSize(length, length));
+            auto pBuffer = detail::MakeArena(bytes);
+            Dense life(length, length, pArena.get(), 3);
+            History history(length, length, capacity, keyframeInterval, pBuffer.get(), bytes);
+            life.SetTopology(Topology::Stitched);
+            life.SetHistory(&history);
+
+            int fewest = capacity;
+            bool rewound = false;
+            while (life.GetGeneration() < static_cast<uint64_t>(generations))
+            {
+                life.Next();
+                const uint64_t generation = life.GetGeneration();
+                const int count = history.GetCount();
+                if (count < 1 || count > capacity || static_cast<uint64_t>(count) > generation + 1)
+                {
+                    std::printf("History: %d generations kept at generation %llu\n", count, static_cast<unsigned long long>(generation));
+                    return false;
+                }
+                fewest = !rewound && generation >= static_cast<uint64_t>(capacity) && count < fewest ? count : fewest;
+                for (int age = 0; age < count; age++)
+                {
+                    history.Rebuild(age);
+                    for (int d = 0; d < GameOfLifeDimension; d++)
+                    {
+                        if (!detail::IsSameFace("History", generation - age, d, getFrame(generation - age, d), history.GetFace(d)))
+                        {
+                            return false;
+                        }
+                    }
+                }
+
+                // halfway the engine goes back as far as the history reaches and steps on from there
+                if (generation == generations / 2 && !rewound)
+                {
+                    rewound = true;
+                    if (life.Rewind(count) || !life.Rewind(count - 1) || life.GetGeneration() != generation - (count - 1) ||
+                        history.GetCount() != 1)
+                    {
+                        std::printf("History: rewinding %d generations from %llu\n", count - 1, static_cast<unsigned long long>(generation));
+                        return false;
+                    }
+                    for (int d = 0; d < GameOfLifeDimension; d++)
+                    {
+                        if (!detail::IsSameFace("History", life.GetGeneration(), d, getFrame(life.GetGeneration(), d), life.GetCurrent(d)))
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+            for (int d = 0; d < GameOfLifeDimension; d++)
+            {
+                if (!detail::IsSameFace("History", generations, d, getFrame(generations, d), life.GetCurrent(d)))
+                {
+                    return false;
+                }
+            }
+
+            // the larger buffer runs out of generations and drops a keyframe with its deltas, the smaller one of bytes
+            const bool tight = bytes < minimum + sizeof(uint32_t) * capacity * frameWords;
+            if (!rewound || fewest > capacity - (tight ? keyframeInterval : 1) || fewest <= (tight ? 0 : capacity - keyframeInterval))
+            {
+                std::printf("History: at least %d of %d generations kept in %zu bytes\n", fewest, capacity, bytes);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Blender against AlphaBlend() for every alpha and foreground over 16 backgrounds, then at the alphas of the
+    // cube (100 and 150) for every background under 256 foregrounds. Both pixels of a word are blended, and
+    // every background is blended in either of them.
+    inline bool CheckBlender() noexcept
+    {
+        detail::Xoshiro128 rnd(23);
+        uint16_t backgrounds[16] = { 0x0000, 0xFFFF };
+        for (int i = 2; i < 16; i++)
+        {
+            backgrounds[i] = static_cast<uint16_t>(rnd());
+        }
+        uint16_t foregrounds[256];
+        for (uint16_t& fg : foregrounds)
+        {
+            fg = static_cast<uint16_t>(rnd());
+        }
+
+        // the pair (bg0, bg1) as the sprite holds it, against AlphaBlend() of each
+        auto isExact = [](uint8_t alpha, uint16_t fg, const Blender& blender, uint16_t bg0, uint16_t bg1) -> bool {
+            const uint32_t pixels = static_cast<uint32_t>(detail::SwapBytes(bg1)) << 16 | detail::SwapBytes(bg0);
+            const uint32_t expected = static_cast<uint32_t>(detail::SwapBytes(AlphaBlend(alpha, fg, bg1))) << 16 | detail::SwapBytes(AlphaBlend(alpha, fg, bg0));
+            if (blender.Blend2(pixels) != expected)
+            {
+                std::printf("Blender: alpha %d, color %04X over %04X, %04X\n", alpha, fg, bg0, bg1);
+                return false;
+            }
+            return true;
+        };
+
+        for (int alpha = 0; alpha < 256; alpha++)
+        {
+            for (int fg = 0; fg < 0x10000; fg++)
+            {
+                const Blender blender(static_cast<uint8_t>(alpha), detail::SwapBytes(static_cast<uint16_t>(fg)));
+                for (int i = 0; i < 16; i++)
+                {
+                    if (!isExact(static_cast<uint8_t>(alpha), static_cast<uint16_t>(fg), blender, backgrounds[i], backgrounds[(i + 1) % 16]))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        for (uint8_t alpha : { 100, 150 })
+        {
+            for (uint16_t fg : foregrounds)
+            {
+                const Blender blender(alpha, detail::SwapBytes(fg));
+                for (int bg = 0; bg < 0x10000; bg++)
+                {
+                    if (!isExact(alpha, fg, blender, static_cast<uint16_t>(bg), static_cast<uint16_t>(bg + 1)))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+}
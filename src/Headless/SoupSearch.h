@@ -0,0 +1,485 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include "../GameOfLifeOnCube/GameOfLife.h"
+#include "Census.h"
+
+namespace Gol3d {
+
+    // Runs soups of the cube until they settle and takes a census of what is left.
+    //
+    // A soup is what GameOfLifeImpl(col, row, pArena, seed) starts with, so a seed found here shows the same
+    // cells on the device with the same face size, density and topology. The settled cells are split into
+    // objects (cells closer than 3 may interact and stay together), and every object is stepped on its own
+    // on an empty cube until it repeats, which tells still lifes, oscillators and spaceships apart.
+    // Objects are laid flat across the edges of the face most of their cells are on, so their codes match the
+    // ones of the plane. Three faces around a corner of the stitched cube do not lie flat, such objects count
+    // as zz_CORNER.
+    //
+    // All buffers are allocated by the constructor, Search() does not allocate.
+    template <uint32_t Rule>
+    class SoupSearch
+    {
+    public:
+        typedef GameOfLifeImpl<Rule> GameOfLife;
+        static const int Dimension = GameOfLifeDimension;
+        static const int MaxObjectCells = 512;
+        static const int MaxSpan = 64;       // the largest object bounding box that gets a code
+        static const int MaxPeriod = 64;
+        static const int MaxGenerations = 1 << 15;
+        static const int HistoryLength = 256; // generations of population a settled soup has to repeat
+        static const int CycleCacheLength = 16;
+
+        SoupSearch(int length, Topology topology, uint32_t density) noexcept
+        : m_Length(length)
+        , m_Words(detail::GetWordCount(length))
+        , m_Topology(topology)
+        , m_pSoupArena(new uint32_t[GameOfLife::GetArenaSize(length, length) / sizeof(uint32_t)])
+        , m_pProbeArena(new uint32_t[GameOfLife::GetArenaSize(length, length) / sizeof(uint32_t)])
+        , m_pCycleCache(new uint64_t[GameOfLife::GetCycleCacheSize(length, length, CycleCacheLength) / sizeof(uint64_t) + 1])
+        , m_pVisited(new uint32_t[Dimension * length * m_Words])
+        , m_pObject(new uint32_t[Dimension * length * m_Words])
+        , m_pStack(new CellPosition[Dimension * length * length])
+        , m_Soup(length, length, m_pSoupArena.get(), 0)
+        , m_Probe(length, length, m_pProbeArena.get(), 0)
+        {
+            std::memset(m_pObject.get(), 0, sizeof(uint32_t) * Dimension * length * m_Words);
+            m_Soup.SetTopology(topology);
+            m_Soup.SetDensity(density);
+            m_Soup.SetCycleCache(m_pCycleCache.get(), CycleCacheLength);
+            m_Probe.SetTopology(topology);
+        }
+
+        // Runs the soup of the seed and adds its objects to census, false when it did not settle.
+        bool Search(long seed, Census& census) noexcept
+        {
+            m_Soup.SetSeed(seed);
+            m_Soup.SetState(2);
+            m_Soup.Next();
+            if (!Settle())
+            {
+                return false;
+            }
+
+            std::memset(m_pVisited.get(), 0, sizeof(uint32_t) * Dimension * m_Length * m_Words);
+            for (int d = 0; d < Dimension; d++)
+            {
+                const Bitmap bitmap = m_Soup.GetCurrent(d);
+                for (int y = 0; y < m_Length; y++)
+                {
+                    for (int x = 0; x < m_Length; x++)
+                    {
+                        if (IsAlive(bitmap, x, y) && !IsVisited(d, x, y))
+                        {
+                            const int count = CollectObject(d, x, y);
+                            Classify(count, seed, census);
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+
+    private:
+        struct CellPosition
+        {
+            uint8_t face;
+            int16_t x;
+            int16_t y;
+        };
+
+        static bool IsAlive(const Bitmap& bitmap, int x, int y) noexcept
+        {
+            return ((bitmap.pRows[y * bitmap.stride + (x >> 5)] >> (x & 31)) & 1) != 0;
+        }
+
+        bool IsVisited(int d, int x, int y) const noexcept
+        {
+            return ((m_pVisited[(d * m_Length + y) * m_Words + (x >> 5)] >> (x & 31)) & 1) != 0;
+        }
+
+        void SetVisited(int d, int x, int y) noexcept
+        {
+            m_pVisited[(d * m_Length + y) * m_Words + (x >> 5)] |= 1u << (x & 31);
+        }
+
+        const detail::EdgeLink (&GetLinks() const noexcept)[Dimension][detail::EdgeCount]
+        {
+            return m_Topology == Topology::Torus ? detail::TorusEdgeLinks : detail::StitchedEdgeLinks;
+        }
+
+        // counted by the kernel while stepping, the board is not scanned again
+        static int GetPopulation(const GameOfLife& life) noexcept
+        {
+            int population = 0;
+            for (int d = 0; d < Dimension; d++)
+            {
+                population += life.GetStatistics(d).live;
+            }
+            return population;
+        }
+
+        // Steps until the soup repeats (exactly, or in population once gliders travel the cube).
+        bool Settle() noexcept
+        {
+            for (int g = 0; g < MaxGenerations; g++)
+            {
+                m_Soup.Next();
+                if (m_Soup.GetPeriod() != 0)
+                {
+                    return true;
+                }
+                m_History[g % HistoryLength] = GetPopulation(m_Soup);
+                if (g >= HistoryLength && g % 32 == 0 && IsPopulationPeriodic(g))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool IsPopulationPeriodic(int g) const noexcept
+        {
+            for (int p = 1; p <= MaxPeriod; p++)
+            {
+                int i = 0;
+                while (i < HistoryLength - p && m_History[(g - i) % HistoryLength] == m_History[(g - i - p) % HistoryLength])
+                {
+                    i++;
+                }
+                if (i == HistoryLength - p)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // the cell at (x, y) of the face d, which may lie beyond an edge (see detail::LocateCell())
+        bool Locate(int d, int x, int y, CellPosition& cell) const noexcept
+        {
+            if (!detail::LocateCell(m_Topology, m_Length, m_Length, d, x, y))
+            {
+                return false;
+            }
+            cell = { static_cast<uint8_t>(d), static_cast<int16_t>(x), static_cast<int16_t>(y) };
+            return true;
+        }
+
+        // Flood fills the cells within 2 of each other from (d, x, y) into the stack, returns their count.
+        int CollectObject(int d, int x, int y) noexcept
+        {
+            int count = 0;
+            m_pStack[count++] = { static_cast<uint8_t>(d), static_cast<int16_t>(x), static_cast<int16_t>(y) };
+            SetVisited(d, x, y);
+            for (int i = 0; i < count; i++)
+            {
+                const CellPosition cell = m_pStack[i];
+                for (int dy = -2; dy <= 2; dy++)
+                {
+                    for (int dx = -2; dx <= 2; dx++)
+                    {
+                        CellPosition next;
+                        if (Locate(cell.face, cell.x + dx, cell.y + dy, next) &&
+                            !IsVisited(next.face, next.x, next.y) &&
+                            IsAlive(m_Soup.GetCurrent(next.face), next.x, next.y))
+                        {
+                            SetVisited(next.face, next.x, next.y);
+                            m_pStack[count++] = next;
+                        }
+                    }
+                }
+            }
+            return count;
+        }
+
+        // Lays the cells of the probe flat around the face m_BaseFace (a torus face around m_Base), the faces
+        // beyond its edges as flaps of the plane, false when some of them are on the opposite face.
+        bool Unfold(int& count, int& faces) noexcept
+        {
+            count = 0;
+            faces = 0;
+            const int n = m_Length;
+            bool empty[Dimension];
+            for (int d = 0; d < Dimension; d++)
+            {
+                bool flat = d == m_BaseFace;
+                for (int e = 0; e < detail::EdgeCount; e++)
+                {
+                    flat |= GetLinks()[m_BaseFace][e].face == d;
+                }
+                empty[d] = IsEmpty(m_Probe.GetCurrent(d));
+                if (!flat && !empty[d])
+                {
+                    return false;
+                }
+            }
+
+            // The stitched plane reaches a face beyond every edge, one face a square of it,
+            // and the squares past the corners are on no face.
+            const int begin = m_Topology == Topology::Torus ? 0 : -n;
+            const int end = m_Topology == Topology::Torus ? n : 2 * n;
+            for (int top = begin; top < end; top += n)
+            {
+                for (int left = begin; left < end; left += n)
+                {
+                    int face = m_BaseFace;
+                    int cx = left;
+                    int cy = top;
+                    if (!detail::LocateCell(m_Topology, n, n, face, cx, cy) || empty[face])
+                    {
+                        continue;
+                    }
+                    for (int y = top; y < top + n; y++)
+                    {
+                        for (int x = left; x < left + n; x++)
+                        {
+                            int d = m_BaseFace;
+                            cx = x;
+                            cy = y;
+                            if (!detail::LocateCell(m_Topology, n, n, d, cx, cy) || !IsAlive(m_Probe.GetCurrent(d), cx, cy))
+                            {
+                                continue;
+                            }
+                            if (count == MaxObjectCells)
+                            {
+                                return false;
+                            }
+                            m_Points[count++] = d == m_BaseFace ? UnfoldBase(x, y) : detail::Point { x, y };
+                        }
+                    }
+                    faces++;
+                }
+            }
+            return true;
+        }
+
+        bool IsEmpty(const Bitmap& bitmap) const noexcept
+        {
+            for (int y = 0; y < m_Length; y++)
+            {
+                for (int w = 0; w < m_Words; w++)
+                {
+                    if (bitmap.pRows[y * bitmap.stride + w] != 0)
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        detail::Point UnfoldBase(int x, int y) const noexcept
+        {
+            if (m_Topology != Topology::Torus)
+            {
+                return { x, y };
+            }
+            const int n = m_Length;
+            return { m_Base.x + ((x - m_Base.x + n + n / 2) % n) - n / 2, m_Base.y + ((y - m_Base.y + n + n / 2) % n) - n / 2 };
+        }
+
+        // Moves the points to the origin and writes their best code to pCode, false when they are too large.
+        bool Canonize(int count, detail::Point& origin, char* pCode, int& length) noexcept
+        {
+            int minX = m_Points[0].x, maxX = minX, minY = m_Points[0].y, maxY = minY;
+            for (int i = 1; i < count; i++)
+            {
+                minX = m_Points[i].x < minX ? m_Points[i].x : minX;
+                maxX = m_Points[i].x > maxX ? m_Points[i].x : maxX;
+                minY = m_Points[i].y < minY ? m_Points[i].y : minY;
+                maxY = m_Points[i].y > maxY ? m_Points[i].y : maxY;
+            }
+            origin = { minX, minY };
+            if (maxX - minX >= MaxSpan || maxY - minY >= MaxSpan)
+            {
+                return false;
+            }
+            for (int i = 0; i < count; i++)
+            {
+                m_Points[i].x -= minX;
+                m_Points[i].y -= minY;
+            }
+
+            length = -1;
+            char code[MaxCodeLength];
+            for (int orientation = 0; orientation < 8; orientation++)
+            {
+                const int l = detail::EncodeWechsler<MaxSpan>(m_Points, count, maxX - minX + 1, maxY - minY + 1, orientation, code, MaxCodeLength);
+                if (l >= 0 && detail::IsBetterCode(code, l, pCode, length))
+                {
+                    std::memcpy(pCode, code, l + 1);
+                    length = l;
+                }
+            }
+            return length >= 0;
+        }
+
+        // true when the points are the ones of the first phase (both moved to the origin)
+        bool IsFirstPhase(int count) const noexcept
+        {
+            if (count != m_FirstCount)
+            {
+                return false;
+            }
+            for (int i = 0; i < count; i++)
+            {
+                const detail::Point& p = m_Points[i];
+                if (((m_FirstPhase[p.y * MaxSpan / 32 + p.x / 32] >> (p.x & 31)) & 1) == 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Steps the object collected in the stack on the empty probe cube and adds it to the census.
+        void Classify(int count, long seed, Census& census) noexcept
+        {
+            if (count > MaxObjectCells)
+            {
+                census.Add("zz_LARGE", seed, 0);
+                return;
+            }
+
+            int cellsOnFace[Dimension] = {};
+            for (int i = 0; i < count; i++)
+            {
+                const CellPosition& cell = m_pStack[i];
+                m_pObject[(cell.face * m_Length + cell.y) * m_Words + (cell.x >> 5)] |= 1u << (cell.x & 31);
+                cellsOnFace[cell.face]++;
+            }
+            m_BaseFace = 0;
+            for (int d = 1; d < Dimension; d++)
+            {
+                m_BaseFace = cellsOnFace[d] > cellsOnFace[m_BaseFace] ? d : m_BaseFace;
+            }
+            for (int i = 0; i < count && m_Topology == Topology::Torus; i++)
+            {
+                if (m_pStack[i].face == m_BaseFace)
+                {
+                    m_Base = { m_pStack[i].x, m_pStack[i].y };
+                    break;
+                }
+            }
+            for (int d = 0; d < Dimension; d++)
+            {
+                m_Probe.SetCurrent(d, { m_pObject.get() + d * m_Length * m_Words, m_Words, m_Length, m_Length });
+            }
+            for (int i = 0; i < count; i++)
+            {
+                const CellPosition& cell = m_pStack[i];
+                m_pObject[(cell.face * m_Length + cell.y) * m_Words + (cell.x >> 5)] = 0;
+            }
+
+            char code[MaxCodeLength];
+            char best[MaxCodeLength];
+            int bestLength = -1;
+            int length;
+            int faces;
+            detail::Point first;
+            const bool unfolded = Unfold(m_FirstCount, faces);
+            if (unfolded && faces > 2)
+            {
+                census.Add("zz_CORNER", seed, faces);
+                return;
+            }
+            if (!unfolded || !Canonize(m_FirstCount, first, best, bestLength))
+            {
+                census.Add("zz_PATHOLOGICAL", seed, faces);
+                return;
+            }
+            std::memset(m_FirstPhase, 0, sizeof(m_FirstPhase));
+            for (int i = 0; i < m_FirstCount; i++)
+            {
+                m_FirstPhase[m_Points[i].y * MaxSpan / 32 + m_Points[i].x / 32] |= 1u << (m_Points[i].x & 31);
+            }
+
+            for (int period = 1; period <= MaxPeriod; period++)
+            {
+                m_Probe.Next();
+                int phaseCount;
+                int phaseFaces;
+                detail::Point origin;
+                if (!Unfold(phaseCount, phaseFaces) || phaseCount == 0)
+                {
+                    break;
+                }
+                if (phaseFaces > 2)
+                {
+                    census.Add("zz_CORNER", seed, phaseFaces);
+                    return;
+                }
+                if (!Canonize(phaseCount, origin, code, length))
+                {
+                    break;
+                }
+                faces = phaseFaces > faces ? phaseFaces : faces;
+                if (IsFirstPhase(phaseCount))
+                {
+                    const bool moved = origin.x != first.x || origin.y != first.y;
+                    if (moved)
+                    {
+                        faces = Travel(faces);
+                    }
+                    char name[MaxCodeLength];
+                    const int l = std::snprintf(name, sizeof(name), "%s%d_%s", moved ? "xq" : period == 1 ? "xs" : "xp", period == 1 && !moved ? m_FirstCount : period, best);
+                    census.Add(l < MaxCodeLength ? name : "zz_LARGE", seed, faces);
+                    return;
+                }
+                if (detail::IsBetterCode(code, length, best, bestLength))
+                {
+                    std::memcpy(best, code, length + 1);
+                    bestLength = length;
+                }
+            }
+            census.Add("zz_PATHOLOGICAL", seed, faces);
+        }
+
+        // Lets a spaceship travel four times across a face, returns the most faces it was seen on.
+        int Travel(int faces) noexcept
+        {
+            int seen = 0;
+            for (int g = 0; g < 4 * m_Length; g++)
+            {
+                m_Probe.Next();
+                for (int d = 0; d < Dimension; d++)
+                {
+                    const Bitmap bitmap = m_Probe.GetCurrent(d);
+                    for (int y = 0; y < m_Length && (seen & (1 << d)) == 0; y++)
+                    {
+                        for (int w = 0; w < m_Words; w++)
+                        {
+                            seen |= bitmap.pRows[y * bitmap.stride + w] != 0 ? 1 << d : 0;
+                        }
+                    }
+                }
+            }
+            return __builtin_popcount(seen) > faces ? __builtin_popcount(seen) : faces;
+        }
+
+        const int m_Length;
+        const int m_Words;
+        const Topology m_Topology;
+        std::unique_ptr<uint32_t[]> m_pSoupArena;
+        std::unique_ptr<uint32_t[]> m_pProbeArena;
+        std::unique_ptr<uint64_t[]> m_pCycleCache;
+        std::unique_ptr<uint32_t[]> m_pVisited; // a bit per cell of the soup, set once it belongs to an object
+        std::unique_ptr<uint32_t[]> m_pObject;  // the cells of the object being classified, cleared after use
+        std::unique_ptr<CellPosition[]> m_pStack;
+        GameOfLife m_Soup;
+        GameOfLife m_Probe;
+
+        int m_History[HistoryLength];
+        int m_BaseFace = 0;
+        detail::Point m_Base = { 0, 0 };
+        detail::Point m_Points[MaxObjectCells];
+        uint32_t m_FirstPhase[MaxSpan * MaxSpan / 32];
+        int m_FirstCount = 0;
+    };
+
+}
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "../GameOfLifeOnCube/GameOfLife.h"
+#include "../GameOfLifeOnCube/Parallel.h"
+#include "Census.h"
+#include "Check.h"
+#include "SoupSearch.h"
+
+// usage: headless [soups [first seed [length [threads [torus|stitched [density %]]]]]]
+//        headless check
+//
+// Runs the soups of the seeds first seed .. first seed + soups - 1 on the cube and prints the census of
+// the objects they settle into, each with the smallest seed that shows it (Cube(..., seed, ...) on the device).
+// check steps the engines the device does not use against GameOfLifeImpl, and fails on the first difference.
+
+namespace {
+
+    typedef Gol3d::SoupSearch<Gol3d::ConwayRule> Search;
+
+    // seeds are handed out in batches so that the counter is not fought over
+    constexpr const long SeedBatch = 64;
+
+    struct Worker
+    {
+        Worker(int length, Gol3d::Topology topology, uint32_t density) noexcept
+        : search(length, topology, density)
+        , census(new Gol3d::Census())
+        {
+        }
+
+        Search search;
+        std::unique_ptr<Gol3d::Census> census;
+        uint64_t unsettled = 0;
+        long firstUnsettled = 0;
+    };
+
+    struct Context
+    {
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<long> next;
+        long end;
+    };
+
+    struct Check
+    {
+        const char* name;
+        bool (*run)();
+    };
+
+    constexpr const Check Checks[] = {
+        { "StepKernel", Gol3d::CheckStepKernels },
+        { "ThreadPool", Gol3d::CheckParallel },
+        { "SparseLifeImpl", Gol3d::CheckSparseLife },
+        { "HashLifeImpl", Gol3d::CheckHashLife },
+        { "EnsembleImpl", Gol3d::CheckEnsemble },
+        { "GenerationsImpl", Gol3d::CheckGenerations },
+        { "LargerThanLifeImpl", Gol3d::CheckLargerThanLife },
+        { "History", Gol3d::CheckHistory },
+        { "Blender", Gol3d::CheckBlender },
+    };
+
+    int RunChecks() noexcept
+    {
+        int failed = 0;
+        for (const Check& check : Checks)
+        {
+            const bool ok = check.run();
+            std::printf("%s %s\n", ok ? "ok" : "FAILED", check.name);
+            failed += ok ? 0 : 1;
+        }
+        return failed == 0 ? 0 : 1;
+    }
+
+    void SearchTask(void* pContext, int index) noexcept
+    {
+        Context& context = *static_cast<Context*>(pContext);
+        Worker& worker = *context.workers[index];
+        for (long begin = context.next.fetch_add(SeedBatch); begin < context.end; begin = context.next.fetch_add(SeedBatch))
+        {
+            const long end = std::min(begin + SeedBatch, context.end);
+            for (long seed = begin; seed < end; seed++)
+            {
+                if (!worker.search.Search(seed, *worker.census))
+                {
+                    worker.firstUnsettled = worker.unsettled == 0 ? seed : std::min(worker.firstUnsettled, seed);
+                    worker.unsettled++;
+                }
+            }
+        }
+    }
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc == 2 && std::strcmp(argv[1], "check") == 0)
+    {
+        return RunChecks();
+    }
+
+    const long soups = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 1000000;
+    const long firstSeed = argc > 2 ? std::strtol(argv[2], nullptr, 10) : 0;
+    const int length = argc > 3 ? std::atoi(argv[3]) : 32;
+    const int threads = argc > 4 ? std::atoi(argv[4]) : 0;
+    const Gol3d::Topology topology = argc > 5 && std::strcmp(argv[5], "torus") == 0 ? Gol3d::Topology::Torus : Gol3d::Topology::Stitched;
+    const int percent = argc > 6 ? std::atoi(argv[6]) : 10;
+    if (length < Search::GameOfLife::MinLength || length > Search::GameOfLife::MaxLength || soups < 0)
+    {
+        std::fprintf(stderr, "usage: %s [soups [first seed [length (%d .. %d) [threads [torus|stitched [density %%]]]]]]\n",
+                     argv[0], Search::GameOfLife::MinLength, Search::GameOfLife::MaxLength);
+        return 1;
+    }
+
+    // one worker per thread, everything the search needs is allocated here
+    Gol3d::ThreadPool pool(threads);
+    Context context;
+    for (int i = 0; i < pool.GetThreadCount(); i++)
+    {
+        context.workers.emplace_back(new Worker(length, topology, Gol3d::DensityFromPercent(percent)));
+    }
+    context.next = firstSeed;
+    context.end = firstSeed + soups;
+
+    const auto start = std::chrono::steady_clock::now();
+    pool.For(pool.GetThreadCount(), SearchTask, &context);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Gol3d::Census& census = *context.workers[0]->census;
+    uint64_t unsettled = context.workers[0]->unsettled;
+    long firstUnsettled = context.workers[0]->firstUnsettled;
+    for (size_t i = 1; i < context.workers.size(); i++)
+    {
+        const Worker& worker = *context.workers[i];
+        census.Merge(*worker.census);
+        if (worker.unsettled != 0)
+        {
+            firstUnsettled = unsettled == 0 ? worker.firstUnsettled : std::min(firstUnsettled, worker.firstUnsettled);
+            unsettled += worker.unsettled;
+        }
+    }
+
+    std::vector<const Gol3d::Census::Entry*> entries;
+    for (int i = 0; i < Gol3d::Census::Capacity; i++)
+    {
+        if (census.GetEntries()[i].count != 0)
+        {
+            entries.push_back(&census.GetEntries()[i]);
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Gol3d::Census::Entry* pLeft, const Gol3d::Census::Entry* pRight) {
+        return pLeft->count != pRight->count ? pLeft->count > pRight->count : std::strcmp(pLeft->code, pRight->code) < 0;
+    });
+
+    std::printf("# %ld soups from seed %ld, %dx%d %s faces, %d%% density, %d threads, %.1f s (%.0f soups/s)\n",
+                soups, firstSeed, length, length, topology == Gol3d::Topology::Torus ? "torus" : "stitched", percent,
+                pool.GetThreadCount(), seconds, seconds > 0 ? soups / seconds : 0.0);
+    if (unsettled != 0)
+    {
+        std::printf("# %llu soups did not settle, the first one is seed %ld\n", static_cast<unsigned long long>(unsettled), firstUnsettled);
+    }
+    if (census.GetOverflow() != 0)
+    {
+        std::printf("# %llu objects did not fit the census\n", static_cast<unsigned long long>(census.GetOverflow()));
+    }
+    std::printf("# code count seed faces\n");
+    for (const Gol3d::Census::Entry* pEntry : entries)
+    {
+        std::printf("%s %llu %ld %d\n", pEntry->code, static_cast<unsigned long long>(pEntry->count), pEntry->seed, pEntry->faces);
+    }
+    return 0;
+}
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <Arduino.h>
 #include <M5Core2.h>
 
@@ -17,6 +20,9 @@ namespace {
 
     QueueHandle_t g_Queue = NULL;
     uint32_t g_FrameCount = 0;
+
+    // Gol3d::Scheduler::Turbo steps as many generations as fit in a frame
+    constexpr int GenerationsPerSecond = 30;
 }
 
 namespace {
@@ -80,81 +86,131 @@ namespace {
     {
     public:
         SpriteImpl(LGFX_Sprite* pImpl) : m_pImpl(pImpl) {}
-        virtual void PushImageWithAlphaBlend(uint16_t *pImage, Gol3d::Rect rect, Gol3d::Position pos, uint8_t alpha, uint8_t bgAlpha) noexcept final
+        virtual void PushImageWithAlphaBlend(const uint16_t* pImage, Gol3d::Rect rect, Gol3d::Position pos, uint8_t alpha, uint8_t bgAlpha) noexcept final
         {
-            if (alpha != 255)
+            // clipped once, then the rows of the image and of the sprite are walked side by side
+            const int x0 = std::max(0, pos.x);
+            const int x1 = std::min(static_cast<int>(m_pImpl->width()), pos.x + rect.width);
+            const int y0 = std::max(0, pos.y);
+            const int y1 = std::min(static_cast<int>(m_pImpl->height()), pos.y + rect.height);
+            for (int y = y0; y < y1; y++)
             {
-                for (int y = 0; y < rect.height; y++)
+                const uint16_t* pSource = pImage + (y - pos.y) * rect.width + (x0 - pos.x);
+                uint16_t* pPixel = GetRow(y) + x0;
+                if (alpha == 255)
+                {
+                    std::memcpy(pPixel, pSource, sizeof(uint16_t) * (x1 - x0));
+                    continue;
+                }
+                for (int x = x0; x < x1; x++, pSource++, pPixel++)
                 {
-                    for (int x = 0; x < rect.width; x++)
+                    const uint16_t color = *pSource;
+                    if (color != Gol3d::ColorTransparent)
                     {
-                        const int i = y * rect.width + x;
-
-                        const uint16_t color = pImage[i];
-                        const uint16_t bgColor = Gol3d::SwappedColor(static_cast<uint16_t>(m_pImpl->readPixelValue(x + pos.x, y + pos.y)));
-
-                        if (color == Gol3d::ColorTransparent)
-                        {
-                            pImage[i] = Gol3d::SwappedColor(bgColor);
-                        }
-                        else
-                        {
-                            auto color565 = Gol3d::SwappedColor(color);
-                            color565 = AlphaBlend(color != Gol3d::ColorBlack ? alpha : bgAlpha, color565, bgColor);
-                            pImage[i] = Gol3d::SwappedColor(color565);
-                        }
+                        *pPixel = Gol3d::Blender(color != Gol3d::ColorBlack ? alpha : bgAlpha, color).Blend(*pPixel);
                     }
                 }
             }
-            
-            m_pImpl->pushImage(pos.x, pos.y, rect.width, rect.height, pImage);
         }
 
-        virtual void PushImageAffineWithAlphaBlend(uint16_t* pImage, Gol3d::Rect rect, float affine[6], uint8_t alpha, uint8_t bgAlpha) noexcept final
+        virtual void DrawCellsWithAlphaBlend(const Gol3d::StateBitmap& states, const uint16_t* pRamp, const Gol3d::FPosition dst[3], uint8_t alpha, uint8_t bgAlpha) noexcept final
         {
-            if (alpha != 255)
+            // the colors of the ramp are all the face has, their part of the blend is worked out once
+            Gol3d::Blender blenders[16];
+            for (int s = 0; s < states.states; s++)
             {
-                for (int y = 0; y < rect.height; y++)
+                blenders[s] = Gol3d::Blender(pRamp[s] != Gol3d::ColorBlack ? alpha : bgAlpha, pRamp[s]);
+            }
+
+            const Gol3d::Bitmap& plane = states.planes[0];
+            const Gol3d::Rect texture = { plane.width, plane.height };
+            const Gol3d::Rect clip = { static_cast<int>(m_pImpl->width()), static_cast<int>(m_pImpl->height()) };
+            Gol3d::RasterizeParallelogram(dst, texture, clip, [&](const Gol3d::Span& span) {
+                uint16_t* pRow = GetRow(span.y);
+                int32_t u = span.u;
+                int32_t v = span.v;
+                int x = span.x0;
+                if ((x & 1) != 0)
                 {
-                    for (int x = 0; x < rect.width; x++)
+                    pRow[x] = blenders[GetState(states, u, v)].Blend(pRow[x]);
+                    x++;
+                    u += span.du;
+                    v += span.dv;
+                }
+
+                // pairs of pixels a word, most of them show the same cell
+                for (; x + 1 < span.x1; x += 2, u += 2 * span.du, v += 2 * span.dv)
+                {
+                    const int state0 = GetState(states, u, v);
+                    const int state1 = GetState(states, u + span.du, v + span.dv);
+                    if (state0 == state1)
                     {
-                        const int dx = (int)(affine[0] * x + affine[1] * y + affine[2]);
-                        const int dy = (int)(affine[3] * x + affine[4] * y + affine[5]);
-                        const uint16_t color = pImage[y * rect.width + x];
-                        const uint16_t bgColor = Gol3d::SwappedColor(static_cast<uint16_t>(m_pImpl->readPixelValue(dx, dy)));
-                        if (color == Gol3d::ColorTransparent)
-                        {
-                            pImage[y * rect.width + x] = Gol3d::SwappedColor(bgColor);
-                        }
-                        else
-                        {
-                            auto color565 = Gol3d::SwappedColor(color);
-                            color565 = AlphaBlend(color != Gol3d::ColorBlack ? alpha : bgAlpha, color565, bgColor);
-                            pImage[y * rect.width + x] = Gol3d::SwappedColor(color565);
-                        }
+                        BlendPair(blenders[state0], pRow + x);
+                    }
+                    else
+                    {
+                        pRow[x] = blenders[state0].Blend(pRow[x]);
+                        pRow[x + 1] = blenders[state1].Blend(pRow[x + 1]);
                     }
                 }
-            }
+                if (x < span.x1)
+                {
+                    pRow[x] = blenders[GetState(states, u, v)].Blend(pRow[x]);
+                }
+            });
+        }
 
-            m_pImpl->pushImageAffine(affine, rect.width, rect.height, pImage);
+        virtual void FillWithAlphaBlend(const Gol3d::FPosition dst[3], uint16_t color, uint8_t alpha, uint8_t bgAlpha) noexcept final
+        {
+            const Gol3d::Blender blender(color != Gol3d::ColorBlack ? alpha : bgAlpha, color);
+            const Gol3d::Rect clip = { static_cast<int>(m_pImpl->width()), static_cast<int>(m_pImpl->height()) };
+            Gol3d::RasterizeParallelogram(dst, { 1, 1 }, clip, [&](const Gol3d::Span& span) {
+                uint16_t* pRow = GetRow(span.y);
+                int x = span.x0;
+                if ((x & 1) != 0)
+                {
+                    pRow[x] = blender.Blend(pRow[x]);
+                    x++;
+                }
+                for (; x + 1 < span.x1; x += 2)
+                {
+                    BlendPair(blender, pRow + x);
+                }
+                if (x < span.x1)
+                {
+                    pRow[x] = blender.Blend(pRow[x]);
+                }
+            });
         }
 
     private:
-        static uint16_t AlphaBlend(uint8_t alpha, uint16_t fgc, uint16_t bgc)
+        // 16 bit sprites hold swapped RGB565 pixels, width() of them a row
+        uint16_t* GetRow(int y) const noexcept
         {
-            uint16_t fgR = ((fgc >> 10) & 0x3E) + 1;
-            uint16_t fgG = ((fgc >>  4) & 0x7E) + 1;
-            uint16_t fgB = ((fgc <<  1) & 0x3E) + 1;
-
-            uint16_t bgR = ((bgc >> 10) & 0x3E) + 1;
-            uint16_t bgG = ((bgc >>  4) & 0x7E) + 1;
-            uint16_t bgB = ((bgc <<  1) & 0x3E) + 1;
+            return static_cast<uint16_t*>(m_pImpl->getBuffer()) + y * m_pImpl->width();
+        }
 
-            uint16_t r = (((fgR * alpha) + (bgR * (255 - alpha))) >> 9);
-            uint16_t g = (((fgG * alpha) + (bgG * (255 - alpha))) >> 9);
-            uint16_t b = (((fgB * alpha) + (bgB * (255 - alpha))) >> 9);
+        // pPixels is at an even x (the rows have an even width, so it is aligned)
+        static void BlendPair(const Gol3d::Blender& blender, uint16_t* pPixels) noexcept
+        {
+            void* pPair = __builtin_assume_aligned(pPixels, sizeof(uint32_t));
+            uint32_t pixels;
+            std::memcpy(&pixels, pPair, sizeof(pixels));
+            pixels = blender.Blend2(pixels);
+            std::memcpy(pPair, &pixels, sizeof(pixels));
+        }
 
-            return (r << 11) | (g << 5) | (b << 0);
+        // the state of the cell at (u, v), 16.16 fixed point
+        static int GetState(const Gol3d::StateBitmap& states, int32_t u, int32_t v) noexcept
+        {
+            const int cellX = u >> 16;
+            const int offset = (v >> 16) * states.planes[0].stride + (cellX >> 5);
+            int state = 0;
+            for (int p = 0; p < states.planeCount; p++)
+            {
+                state |= ((states.planes[p].pRows[offset] >> (cellX & 31)) & 1) << p;
+            }
+            return state;
         }
 
         LGFX_Sprite* m_pImpl;
@@ -172,10 +228,85 @@ namespace {
 
 }
 
+namespace {
+
+    // Shares the work with a task on core 0 while loop() works on core 1.
+    class ParallelImpl : public Gol3d::IParallel
+    {
+    public:
+        void Begin() noexcept
+        {
+            m_Done = xSemaphoreCreateBinary();
+            xTaskCreatePinnedToCore(WorkerTaskFunction, "WorkerTask", 4096, this, 2, &m_Worker, 0);
+        }
+
+        virtual void For(int count, Gol3d::ParallelWork work, void* pContext) noexcept final
+        {
+            if (m_Worker == NULL || count <= 1)
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    work(pContext, i);
+                }
+                return;
+            }
+
+            m_Work = work;
+            m_pContext = pContext;
+            m_Count = count;
+            m_Next = 0;
+            xTaskNotifyGive(m_Worker);
+            Run();
+
+            // the worker leaves Run() before the next generation may start
+            xSemaphoreTake(m_Done, portMAX_DELAY);
+        }
+
+    private:
+        static void WorkerTaskFunction(void* pParameter)
+        {
+            auto pSelf = static_cast<ParallelImpl*>(pParameter);
+            while (true)
+            {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                pSelf->Run();
+                xSemaphoreGive(pSelf->m_Done);
+            }
+        }
+
+        void Run() noexcept
+        {
+            for (int i = m_Next++; i < m_Count; i = m_Next++)
+            {
+                m_Work(m_pContext, i);
+            }
+        }
+
+        TaskHandle_t m_Worker = NULL;
+        SemaphoreHandle_t m_Done = NULL;
+        Gol3d::ParallelWork m_Work = nullptr;
+        void* m_pContext = nullptr;
+        int m_Count = 0;
+        std::atomic<int> m_Next { 0 };
+    } g_Parallel;
+
+}
+
+namespace {
+
+    void ReportStepKernel(Gol3d::StepKernel kernel, unsigned long microseconds)
+    {
+        Serial.printf("%s kernel: %lu us/gen\n", kernel == Gol3d::StepKernel::LookupTable ? "lookup table" : "bitwise", microseconds);
+    }
+
+}
+
 void DrawTaskFunction(void*)
 {
     uint32_t drawFrameCountPerSecond = 0;
     uint32_t drawFrameCount = 0;
+    uint32_t generationCountPerSecond = 0;
+    uint32_t startGenerationCount = Gol3d::GetGenerationCount();
     auto startTick = micros();
 
     while (true)
@@ -187,7 +318,7 @@ void DrawTaskFunction(void*)
 
         ::g_BaseSprite[(g_FrameCount + 1) % 2].pushSprite(24, 20);
         g_Lcd.setCursor(10, 10);
-        g_Lcd.printf("fps: %2d\n", drawFrameCountPerSecond);
+        g_Lcd.printf("fps: %2d gen/s: %4d\n", drawFrameCountPerSecond, generationCountPerSecond);
         drawFrameCount++;
 
         auto currentTick = micros();
@@ -196,12 +327,16 @@ void DrawTaskFunction(void*)
         {
             startTick = currentTick;
             drawFrameCount = 0;
+            startGenerationCount = Gol3d::GetGenerationCount();
         }
         else if (elapsedTick >= 1000000ULL)
         {
+            const uint32_t generationCount = Gol3d::GetGenerationCount();
             startTick = currentTick;
             drawFrameCountPerSecond = drawFrameCount;
             drawFrameCount = 0;
+            generationCountPerSecond = generationCount - startGenerationCount;
+            startGenerationCount = generationCount;
         }
 
         int command = 0;
@@ -218,6 +353,8 @@ void setup()
 
     ::g_Queue = xQueueCreate(1, sizeof(int));
     xTaskCreatePinnedToCore(DrawTaskFunction, "DrawTask", 4096, nullptr, 1, nullptr, 0);
+    ::g_Parallel.Begin();
+    const auto stepKernel = Gol3d::BenchmarkStepKernels(::micros, &::g_Parallel, ::ReportStepKernel);
 
     {
         ::g_BaseSprite[0].createSprite(272, 200);
@@ -234,7 +371,7 @@ void setup()
         MFW::AddObject(std::unique_ptr<MFW::IObject>(new Gol3d::PauseIcon(::GetSprite, {0, 54})));
         MFW::AddObject(std::unique_ptr<MFW::IObject>(new Gol3d::RandomizeIcon(::GetSprite, {0, 90})));
         MFW::AddObject(std::unique_ptr<MFW::IObject>(new Gol3d::InputEvent(&::g_Input)));
-        MFW::AddObject(std::unique_ptr<MFW::IObject>(new Gol3d::Cube(::GetSprite, {136, 100}, 120, analogRead(26))));
+        MFW::AddObject(std::unique_ptr<MFW::IObject>(new Gol3d::Cube(::GetSprite, {136, 100}, 120, analogRead(26), Gol3d::Topology::Stitched, ::micros, ::GenerationsPerSecond, &::g_Parallel, stepKernel)));
     }
 }
 